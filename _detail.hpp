@@ -12,7 +12,7 @@ namespace boxed { template<class T> class Box; }
 template<class T> class non_null;
 
 namespace sync {
-    template<class T> class Mutex;
+    template<class T, class Policy> class Mutex;
 }
 
 namespace detail {
@@ -50,7 +50,7 @@ template <class T> static constexpr bool is_box_v = is_box<T>::value;
 
 // Trait for checking if a type is a rust::sync::Mutex
 template <class T> struct is_mutex_impl : std::false_type {};
-template <class T> struct is_mutex_impl<sync::Mutex<T>> : std::true_type {};
+template <class T, class Policy> struct is_mutex_impl<sync::Mutex<T, Policy>> : std::true_type {};
 template <class T> using is_mutex = is_mutex_impl<std::decay_t<T>>;
 template <class T> static constexpr bool is_mutex_v = is_mutex<T>::value;
 
@@ -77,6 +77,15 @@ struct remove_cvref {
 template<class T>
 using remove_cvref_t = typename remove_cvref<T>::type;
 
+// C++20's type_identity, to keep a parameter out of deduction
+template<class T>
+struct type_identity {
+    using type = T;
+};
+
+template<class T>
+using type_identity_t = typename type_identity<T>::type;
+
 // C++20's is_nothrow_convertible
 template<class From, class To>
 struct is_nothrow_convertible {
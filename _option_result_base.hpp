@@ -17,6 +17,13 @@
 
 namespace rust {
 
+// The type with a single value, for an Option or Result that carries nothing, like Rust's ().
+struct unit_t { constexpr unit_t() noexcept = default; };
+static constexpr unit_t unit{};
+
+[[nodiscard]] inline constexpr bool operator==(unit_t, unit_t) noexcept { return true; }
+[[nodiscard]] inline constexpr bool operator!=(unit_t, unit_t) noexcept { return false; }
+
 namespace option {
 
 template<class T>
@@ -3791,14 +3798,14 @@ struct Option_operations_base : Option_storage_base<T> {
     template <class Opt> 
     void assign(Opt&& rhs) {
         if (is_some()) {
-            if (rhs)
+            if (rhs.is_some())
                 this->value_ = std::forward<Opt>(rhs).get();
             else {
                 this->value_.~T();
                 this->is_some_ = false;
             }
         }
-        else if (rhs)
+        else if (rhs.is_some())
             construct(std::forward<Opt>(rhs).get());
     }
 
@@ -3824,7 +3831,7 @@ struct Option_copy_base<T, false> : Option_operations_base<T> {
 
     Option_copy_base() = default;
     Option_copy_base(Option_copy_base const& rhs) {
-        if (rhs)
+        if (rhs.is_some())
             this->construct(rhs.get());
         else
             this->is_some_ = false;
@@ -3850,7 +3857,7 @@ struct Option_move_base<T, false> : Option_copy_base<T> {
 
     Option_move_base(Option_move_base&& rhs) noexcept(
         std::is_nothrow_move_constructible_v<T>) {
-        if (rhs)
+        if (rhs.is_some())
             this->construct(std::move(rhs.get()));
         else
             this->is_some_ = false;
@@ -4544,7 +4551,7 @@ public:
 
     // as_mut
     [[nodiscard]] constexpr Option<T&> as_mut() {
-        return bool(*this) ? Option<T&>(**this) : None;
+        return bool(*this) ? Option<T&>(some_tag, **this) : None;
     }
 
     // as_pin_ref
@@ -4972,7 +4979,7 @@ public:
 
     // as_mut
     [[nodiscard]] constexpr Option<T&> as_mut() & {
-        return bool(*this) ? Option<T&>(**this) : None;
+        return bool(*this) ? Option<T&>(some_tag, **this) : None;
     }
 
     // as_pin_ref
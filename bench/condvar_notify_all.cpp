@@ -0,0 +1,102 @@
+// condvar_notify_all.cpp
+
+// 64 threads wait on a Condvar and are woken by notify_all, round after round. Prints the time
+// and the process's context switches next to std::condition_variable's. This is the baseline
+// for a notify_all that requeues waiters onto the mutex instead of waking them all, which
+// only pays off with several cores. Not part of any build, e.g.:
+//
+//     g++ -std=c++17 -O2 -I.. condvar_notify_all.cpp -o condvar_notify_all -pthread && ./condvar_notify_all
+
+#include "../sync/condvar.hpp"
+#include "../sync/mutex.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <sys/resource.h>
+
+namespace {
+
+constexpr int waiters = 64;
+constexpr long rounds = 2000;
+
+long context_switches() {
+    ::rusage usage;
+    ::getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_nvcsw + usage.ru_nivcsw;
+}
+
+// Runs the rounds: every waiter blocks until the round's value is published, and the next
+// round starts once all of them are waiting again.
+template<class Wait, class Publish>
+void run(char const* const name, std::atomic<int>& arrived, Wait const& wait, Publish const& publish) {
+    auto const switches = context_switches();
+    auto const start = std::chrono::steady_clock::now();
+    std::vector<std::thread> threads;
+    for (int i = 0; i < waiters; ++i) {
+        threads.emplace_back([&] {
+            for (long round = 1; round <= rounds; ++round)
+                wait(round);
+        });
+    }
+    for (long round = 1; round <= rounds; ++round) {
+        while (arrived.load() < waiters * round)
+            std::this_thread::yield();
+        publish(round);
+    }
+    for (auto& t : threads)
+        t.join();
+    auto const ms = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+    std::printf("%-26s %6lld ms  %8ld context switches\n", name, static_cast<long long>(ms), context_switches() - switches);
+}
+
+template<class Policy>
+void bench_rust(char const* const name) {
+    rust::sync::Mutex<long, Policy> mutex{0};
+    rust::sync::Condvar cv;
+    std::atomic<int> arrived{0};
+    run(name, arrived,
+        [&](long const round) {
+            auto guard = mutex.lock().unwrap();
+            arrived.fetch_add(1);
+            guard = cv.wait_until(std::move(guard), [round](long& value) { return value >= round; }).unwrap();
+        },
+        [&](long const round) {
+            *mutex.lock().unwrap() = round;
+            cv.notify_all();
+        });
+}
+
+void bench_std() {
+    std::mutex mutex;
+    std::condition_variable cv;
+    long value = 0;
+    std::atomic<int> arrived{0};
+    run("std::condition_variable", arrived,
+        [&](long const round) {
+            std::unique_lock lock{mutex};
+            arrived.fetch_add(1);
+            cv.wait(lock, [&] { return value >= round; });
+        },
+        [&](long const round) {
+            {
+                std::lock_guard lock{mutex};
+                value = round;
+            }
+            cv.notify_all();
+        });
+}
+
+} // namespace
+
+int main() {
+    std::printf("%d waiters, %ld rounds, %u hardware threads\n", waiters, rounds, std::thread::hardware_concurrency());
+    bench_std();
+    bench_rust<rust::sync::MutexPolicy<>>("sync::Condvar");
+    bench_rust<rust::sync::FairMutexPolicy<>>("sync::Condvar, fair mutex");
+}
@@ -0,0 +1,93 @@
+// fair_mutex_stress.cpp
+
+// Hammers a fair Mutex with waiters that time out next to ones that block, so unlocks keep
+// finding the contended bit a timed out waiter left behind with nobody asleep. A lost wakeup
+// shows up as a stall, which fails the run. Not part of any build, e.g.:
+//
+//     g++ -std=c++17 -O2 -I.. fair_mutex_stress.cpp -o fair_mutex_stress -pthread && ./fair_mutex_stress [seconds]
+
+#include "../sync/mutex.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+
+int main(int const argc, char** const argv) {
+    using namespace rust;
+    using namespace std::chrono;
+    auto const run_for = seconds{argc > 1 ? std::atoi(argv[1]) : 10};
+    auto const threads = std::max(4u, 2 * std::thread::hardware_concurrency());
+
+    sync::Mutex<std::uint64_t, sync::FairMutexPolicy<sys::spin::Never>> mutex{0};
+    // per thread, acquisitions and timeouts both count
+    std::vector<std::atomic<std::uint64_t>> progress(threads);
+    std::atomic<std::uint64_t> timeouts{0};
+    std::atomic<unsigned> finished{0};
+    std::atomic<bool> stop{false};
+
+    std::vector<std::thread> workers;
+    for (unsigned t = 0; t < threads; ++t) {
+        workers.emplace_back([&, t] {
+            std::uint64_t i = t;
+            while (!stop.load(std::memory_order_relaxed)) {
+                ++i;
+                // every other thread gives up after a few microseconds, leaving the contended bit
+                if (t % 2 == 0) {
+                    auto res = mutex.try_lock_for(microseconds{1 + i % 20});
+                    if (res.is_ok()) {
+                        auto guard = std::move(res).unwrap();
+                        ++*guard;
+                    } else {
+                        timeouts.fetch_add(1, std::memory_order_relaxed);
+                    }
+                } else {
+                    auto guard = mutex.lock().unwrap();
+                    ++*guard;
+                    // hold it long enough for the timed waiters to give up
+                    if (i % 8 == 0)
+                        std::this_thread::sleep_for(microseconds{20});
+                }
+                progress[t].fetch_add(1, std::memory_order_relaxed);
+            }
+            finished.fetch_add(1);
+        });
+    }
+
+    auto const stall = [&](char const* const when) {
+        std::printf("stalled %s after %llu timeouts: a waiter missed its wakeup\n",
+                    when, static_cast<unsigned long long>(timeouts.load()));
+        std::_Exit(1);
+    };
+
+    // every thread has to keep moving, a lost wakeup parks one for good once nobody contends
+    std::vector<std::uint64_t> last(threads);
+    for (auto const end = steady_clock::now() + run_for; steady_clock::now() < end;) {
+        std::this_thread::sleep_for(seconds{2});
+        for (unsigned t = 0; t < threads; ++t) {
+            auto const now = progress[t].load();
+            if (now == last[t])
+                stall("while running");
+            last[t] = now;
+        }
+    }
+    stop.store(true);
+    // the last unlocks find nobody contending, so a thread asleep on a free lock never wakes
+    for (auto const end = steady_clock::now() + seconds{5}; finished.load() != threads;) {
+        if (steady_clock::now() > end)
+            stall("at shutdown");
+        std::this_thread::sleep_for(milliseconds{10});
+    }
+    for (auto& w : workers)
+        w.join();
+
+    std::uint64_t total = 0;
+    for (auto const& p : progress)
+        total += p.load();
+    std::printf("ok: %llu attempts, %llu timeouts, %u threads\n",
+                static_cast<unsigned long long>(total), static_cast<unsigned long long>(timeouts.load()), threads);
+}
@@ -0,0 +1,65 @@
+// pool_sort.cpp
+
+// Times pool::par_sort and pool::par_sort_unstable against std::stable_sort and std::sort on
+// random 64-bit keys, on pools of 1 to 64 threads. Not part of any build, e.g.:
+//
+//     g++ -std=c++17 -O2 -I.. pool_sort.cpp -o pool_sort -pthread && ./pool_sort [n]
+
+#include "../pool/sort.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <thread>
+#include <vector>
+
+namespace {
+
+// the best of a few runs, each on a fresh copy of `src`
+template<class Sort>
+double best_ms(std::vector<std::uint64_t> const& src, std::vector<std::uint64_t> const& expected, Sort const& sort) {
+    double best = 1e300;
+    for (int run = 0; run < 5; ++run) {
+        auto v = src;
+        auto const start = std::chrono::steady_clock::now();
+        sort(v);
+        auto const ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        if (v != expected) {
+            std::fprintf(stderr, "result not sorted\n");
+            std::exit(1);
+        }
+        best = std::min(best, ms);
+    }
+    return best;
+}
+
+} // namespace
+
+int main(int const argc, char** const argv) {
+    using namespace rust;
+    std::size_t const n = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 2'000'000;
+
+    std::mt19937_64 rng{7};
+    std::vector<std::uint64_t> src(n);
+    for (auto& x : src)
+        x = rng();
+    auto expected = src;
+    std::sort(expected.begin(), expected.end());
+
+    auto const std_sort = best_ms(src, expected, [](auto& v) { std::sort(v.begin(), v.end()); });
+    auto const std_stable = best_ms(src, expected, [](auto& v) { std::stable_sort(v.begin(), v.end()); });
+    std::printf("%zu keys, %u hardware threads\n", n, std::thread::hardware_concurrency());
+    std::printf("std::sort        %8.1f ms\nstd::stable_sort %8.1f ms\n\n", std_sort, std_stable);
+    std::printf("threads  par_sort_unstable      par_sort\n");
+
+    for (std::size_t const threads : {1, 2, 4, 8, 16, 32, 64}) {
+        pool::ThreadPool tp{threads};
+        auto const unstable = best_ms(src, expected, [&](auto& v) { (void)tp.install([&] { pool::par_sort_unstable(v); }); });
+        auto const stable = best_ms(src, expected, [&](auto& v) { (void)tp.install([&] { pool::par_sort(v); }); });
+        std::printf("%7zu  %8.1f ms %5.2fx  %8.1f ms %5.2fx\n",
+                    threads, unstable, std_sort / unstable, stable, std_stable / stable);
+    }
+}
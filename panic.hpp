@@ -3,11 +3,12 @@
 #pragma once
 
 #include "_include.hpp"
-#include "thread/thread.hpp"
+#include "thread/_panicking.hpp"
 #include "sys_common/thread.hpp"
 
 #include <exception>
 #include <iostream>
+#include <sstream>
 #include <string>
 #include <utility>
 
@@ -24,15 +25,21 @@ template<class Msg>
         std::abort();
     }
     std::cerr << "rust::panic: " << msg << '\n';
+    // unwind to the enclosing catch_unwind, e.g. the entry of a spawned thread
+    if (thread::impl::catch_depth != 0) {
+        std::ostringstream message;
+        message << msg;
+        throw thread::impl::Unwind{thread::PanicPayload{message.str()}};
+    }
     sys::thread_exit();
 #endif // RUST_PANIC_SHOULD_ABORT
 }
 
-[[noreturn]] void panic() {
+[[noreturn]] inline void panic() {
     panic("explicit panic");
 }
 
-void assert(bool const b) {
+inline void assert(bool const b) {
     if (!b)
         panic("rust::assert() failed");
 }
@@ -0,0 +1,320 @@
+// par_iter.hpp
+
+#pragma once
+
+#include "../_detail.hpp"
+#include "../option.hpp"
+#include "../result.hpp"
+#include "pool.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <functional>
+#include <iterator>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace rust {
+namespace pool {
+
+namespace detail {
+
+// Decides whether a range is worth splitting in two, as rayon does: at first into about as many
+// pieces as there are workers, and again whenever a half got stolen, since a thief means some
+// worker ran out of work. Pieces never get shorter than the minimum length.
+class Splitter {
+    std::size_t splits_;
+    std::size_t min_len_;
+
+public:
+    constexpr Splitter(std::size_t const splits, std::size_t const min_len) noexcept : splits_{splits}, min_len_{min_len} {}
+
+    bool try_split(std::size_t const len, bool const migrated) {
+        if (len / 2 < min_len_)
+            return false;
+        if (migrated) {
+            splits_ = std::max(current_num_threads(), splits_ / 2);
+            return true;
+        }
+        if (splits_ == 0)
+            return false;
+        splits_ /= 2;
+        return true;
+    }
+};
+
+// Runs `leaf` over pieces of [lo, hi) in parallel and merges their results pairwise with
+// `combine`, left before right. Only on a worker thread.
+template<class Leaf, class Combine>
+auto bridge(std::size_t const lo, std::size_t const hi, Splitter splitter, bool const migrated,
+            Leaf const& leaf, Combine const& combine) -> std::invoke_result_t<Leaf const&, std::size_t, std::size_t> {
+    if (!splitter.try_split(hi - lo, migrated))
+        return leaf(lo, hi);
+    auto const mid = lo + (hi - lo) / 2;
+    auto* const origin = current_worker;
+    auto res = current().join(
+        [&] { return bridge(lo, mid, splitter, false, leaf, combine); },
+        [&] { return bridge(mid, hi, splitter, current_worker != origin, leaf, combine); });
+    if (res.is_err())
+        thread::impl::resume_unwind(std::move(res).unwrap_err());
+    auto halves = std::move(res).unwrap();
+    return combine(std::move(halves.first), std::move(halves.second));
+}
+
+// `bridge` over [0, len) on the current pool, continuing any panic on the calling thread.
+template<class Leaf, class Combine>
+auto run(std::size_t const len, std::size_t const min_len, Leaf const& leaf, Combine const& combine) {
+    auto& pool = current();
+    auto res = pool.install([&] { return bridge(0, len, Splitter{pool.num_threads(), min_len}, false, leaf, combine); });
+    if (res.is_err())
+        thread::impl::resume_unwind(std::move(res).unwrap_err());
+    return std::move(res).unwrap();
+}
+
+inline constexpr auto combine_units = [](unit_t, unit_t) noexcept { return unit_t{}; };
+
+// keeps the leftmost error
+inline constexpr auto combine_first_err = [](auto left, auto right) { return left.is_err() ? std::move(left) : std::move(right); };
+
+template<class U>
+std::vector<U> append(std::vector<U> left, std::vector<U> right) {
+    if (left.empty())
+        return right;
+    left.insert(left.end(), std::make_move_iterator(right.begin()), std::make_move_iterator(right.end()));
+    return left;
+}
+
+// Whether the items can be written straight to their index in the output from several workers.
+// Not for std::vector<bool>, whose neighbouring elements share a word.
+template<class U>
+inline constexpr bool collect_in_place_v = std::is_default_constructible_v<U> && !std::is_same_v<U, bool>;
+
+// Pipeline stages pass each element on as zero or one items to a sink.
+// `exact` stages pass every element on, so item `i` comes from element `i`.
+
+template<class T>
+struct Source {
+    using item_type = T&;
+    static constexpr bool exact = true;
+
+    template<class Sink>
+    void operator()(T& x, Sink&& sink) const { sink(x); }
+};
+
+template<class Prev, class F>
+struct MapStage {
+    Prev prev;
+    F f;
+
+    using item_type = std::invoke_result_t<F const&, typename Prev::item_type>;
+    static constexpr bool exact = Prev::exact;
+
+    template<class X, class Sink>
+    void operator()(X& x, Sink&& sink) const {
+        prev(x, [&](auto&& item) { sink(std::invoke(f, std::forward<decltype(item)>(item))); });
+    }
+};
+
+template<class Prev, class P>
+struct FilterStage {
+    Prev prev;
+    P pred;
+
+    using item_type = typename Prev::item_type;
+    static constexpr bool exact = false;
+
+    template<class X, class Sink>
+    void operator()(X& x, Sink&& sink) const {
+        prev(x, [&](auto&& item) {
+            if (std::invoke(pred, std::as_const(item)))
+                sink(std::forward<decltype(item)>(item));
+        });
+    }
+};
+
+} // namespace detail
+
+// A parallel iterator over a contiguous range, run on the current pool. Adapters are lazy and
+// consumers split the range adaptively across the workers:
+//
+//     auto res = pool::par_iter(paths).map(load).collect<result::Result<std::vector<Doc>, Error>>();
+//
+// Consumers block until every piece is done. A panic in any of them continues on the caller.
+template<class T, class Stage>
+class ParIter {
+    T* data_;
+    std::size_t len_;
+    std::size_t min_len_;
+    Stage stage_;
+
+    using item_type = typename Stage::item_type;
+
+    template<class U>
+    std::vector<U> collect_values() {
+        if constexpr (Stage::exact && detail::collect_in_place_v<U>) {
+            // every element yields one item, written in place
+            std::vector<U> out(len_);
+            detail::run(len_, min_len_, [&](std::size_t const lo, std::size_t const hi) {
+                for (auto i = lo; i < hi; ++i)
+                    stage_(data_[i], [&](auto&& item) { out[i] = U(std::forward<decltype(item)>(item)); });
+                return unit_t{};
+            }, detail::combine_units);
+            return out;
+        } else {
+            return detail::run(len_, min_len_, [&](std::size_t const lo, std::size_t const hi) {
+                std::vector<U> out;
+                for (auto i = lo; i < hi; ++i)
+                    stage_(data_[i], [&](auto&& item) { out.emplace_back(std::forward<decltype(item)>(item)); });
+                return out;
+            }, [](std::vector<U> left, std::vector<U> right) { return detail::append(std::move(left), std::move(right)); });
+        }
+    }
+
+    template<class U, class E>
+    result::Result<std::vector<U>, E> collect_results() {
+        using Res = result::Result<std::vector<U>, E>;
+        std::atomic<bool> stop{false};
+        // Feeds the items of [lo, hi) to `ok`, stopping everywhere at the first error.
+        auto const drive = [&](std::size_t const lo, std::size_t const hi, auto&& ok) -> option::Option<E> {
+            option::Option<E> err = option::None;
+            for (auto i = lo; i < hi && !stop.load(std::memory_order_relaxed); ++i) {
+                stage_(data_[i], [&](auto&& item) {
+                    if (item.is_err()) {
+                        err = option::Some<E>(std::forward<decltype(item)>(item).unwrap_err());
+                        stop.store(true, std::memory_order_relaxed);
+                    } else {
+                        ok(i, std::forward<decltype(item)>(item).unwrap());
+                    }
+                });
+                if (err.is_some())
+                    break;
+            }
+            return err;
+        };
+        if constexpr (Stage::exact && detail::collect_in_place_v<U>) {
+            std::vector<U> out(len_);
+            auto res = detail::run(len_, min_len_, [&](std::size_t const lo, std::size_t const hi) {
+                auto err = drive(lo, hi, [&](std::size_t const i, auto&& value) { out[i] = U(std::forward<decltype(value)>(value)); });
+                if (err.is_some())
+                    return result::Err<unit_t, E>(std::move(err).unwrap());
+                return result::Ok<unit_t, E>();
+            }, detail::combine_first_err);
+            if (res.is_err())
+                return result::Err<std::vector<U>, E>(std::move(res).unwrap_err());
+            return result::Ok<std::vector<U>, E>(std::move(out));
+        } else {
+            return detail::run(len_, min_len_, [&](std::size_t const lo, std::size_t const hi) {
+                std::vector<U> out;
+                auto err = drive(lo, hi, [&](std::size_t, auto&& value) { out.emplace_back(std::forward<decltype(value)>(value)); });
+                if (err.is_some())
+                    return result::Err<std::vector<U>, E>(std::move(err).unwrap());
+                return result::Ok<std::vector<U>, E>(std::move(out));
+            }, [](Res left, Res right) {
+                if (left.is_err() || right.is_err())
+                    return detail::combine_first_err(std::move(left), std::move(right));
+                return result::Ok<std::vector<U>, E>(detail::append(std::move(left).unwrap(), std::move(right).unwrap()));
+            });
+        }
+    }
+
+public:
+    constexpr ParIter(T* const data, std::size_t const len, std::size_t const min_len, Stage stage)
+        : data_{data}, len_{len}, min_len_{min_len}, stage_{std::move(stage)} {}
+
+    // Pieces handed to a worker hold at least `n` elements. Raise it for very cheap items.
+    ParIter with_min_len(std::size_t const n) && {
+        min_len_ = std::max<std::size_t>(n, 1);
+        return std::move(*this);
+    }
+
+    template<class F>
+    ParIter<T, detail::MapStage<Stage, F>> map(F f) && {
+        return {data_, len_, min_len_, {std::move(stage_), std::move(f)}};
+    }
+
+    template<class P>
+    ParIter<T, detail::FilterStage<Stage, P>> filter(P pred) && {
+        return {data_, len_, min_len_, {std::move(stage_), std::move(pred)}};
+    }
+
+    template<class F>
+    void for_each(F const& f) && {
+        detail::run(len_, min_len_, [&](std::size_t const lo, std::size_t const hi) {
+            for (auto i = lo; i < hi; ++i)
+                stage_(data_[i], [&](auto&& item) { std::invoke(f, std::forward<decltype(item)>(item)); });
+            return unit_t{};
+        }, detail::combine_units);
+    }
+
+    // `f` returns a Result. The first error stops the remaining items on every worker and is
+    // returned; which one is first is only defined among the errors that did occur.
+    template<class F>
+    auto try_for_each(F const& f) && {
+        using E = typename std::invoke_result_t<F const&, item_type>::err_type;
+        std::atomic<bool> stop{false};
+        return detail::run(len_, min_len_, [&](std::size_t const lo, std::size_t const hi) {
+            option::Option<E> err = option::None;
+            for (auto i = lo; i < hi && !stop.load(std::memory_order_relaxed); ++i) {
+                stage_(data_[i], [&](auto&& item) {
+                    auto res = std::invoke(f, std::forward<decltype(item)>(item));
+                    if (res.is_err()) {
+                        err = option::Some<E>(std::move(res).unwrap_err());
+                        stop.store(true, std::memory_order_relaxed);
+                    }
+                });
+                if (err.is_some())
+                    return result::Err<unit_t, E>(std::move(err).unwrap());
+            }
+            return result::Ok<unit_t, E>();
+        }, detail::combine_first_err);
+    }
+
+    // Folds the items with `op`, which must be associative, starting every piece from `identity()`.
+    template<class Id, class Op>
+    auto reduce(Id const& identity, Op const& op) && {
+        using V = std::decay_t<std::invoke_result_t<Id const&>>;
+        return detail::run(len_, min_len_, [&](std::size_t const lo, std::size_t const hi) {
+            V acc = identity();
+            for (auto i = lo; i < hi; ++i)
+                stage_(data_[i], [&](auto&& item) { acc = std::invoke(op, std::move(acc), std::forward<decltype(item)>(item)); });
+            return acc;
+        }, [&](V left, V right) { return std::invoke(op, std::move(left), std::move(right)); });
+    }
+
+    // Into a `std::vector<U>` in order, or from items that are Results into a
+    // `Result<std::vector<U>, E>`, stopping at the first error as `try_for_each` does.
+    template<class C>
+    C collect() && {
+        if constexpr (rust::detail::is_result_v<C>) {
+            using Vec = typename C::ok_type;
+            static_assert(std::is_same_v<Vec, std::vector<typename Vec::value_type>>, "collects into a std::vector");
+            return collect_results<typename Vec::value_type, typename C::err_type>();
+        } else {
+            static_assert(std::is_same_v<C, std::vector<typename C::value_type>>, "collects into a std::vector");
+            return collect_values<typename C::value_type>();
+        }
+    }
+};
+
+template<class T>
+[[nodiscard]] ParIter<T const, detail::Source<T const>> par_iter(T const* const data, std::size_t const len) {
+    return {data, len, 1, {}};
+}
+
+// Over any contiguous container.
+template<class C>
+[[nodiscard]] auto par_iter(C const& c) { return par_iter(std::data(c), std::size(c)); }
+
+// Items are mutable references to the elements.
+template<class T>
+[[nodiscard]] ParIter<T, detail::Source<T>> par_iter_mut(T* const data, std::size_t const len) {
+    return {data, len, 1, {}};
+}
+
+template<class C>
+[[nodiscard]] auto par_iter_mut(C& c) { return par_iter_mut(std::data(c), std::size(c)); }
+
+} // namespace pool
+} // namespace rust
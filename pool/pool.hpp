@@ -0,0 +1,311 @@
+// pool.hpp
+
+#pragma once
+
+#include "../_include.hpp"
+#include "../option.hpp"
+#include "../result.hpp"
+#include "../sync/event_count.hpp"
+#include "../sync/seg_queue.hpp"
+#include "../sync/work_deque.hpp"
+#include "../sys/futex.hpp"
+#include "../sys/spin.hpp"
+#include "../thread/thread.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace rust {
+namespace pool {
+
+class ThreadPool;
+
+namespace detail {
+
+// A unit of work on a deque, type-erased behind a single function pointer.
+struct Job {
+    void (*execute)(Job*);
+};
+
+// Set once a job has run. The thread waiting for it may sleep on it.
+class JobLatch {
+    static constexpr std::uint32_t unset = 0;
+    static constexpr std::uint32_t done = 1;
+    static constexpr std::uint32_t sleeping = 2;
+
+    std::atomic<std::uint32_t> state_{unset};
+
+public:
+    [[nodiscard]] bool probe() const noexcept { return state_.load(std::memory_order_acquire) == done; }
+
+    // The waiter may return and free the latch as soon as the exchange lands, the wake after it
+    // at worst hits some other waiter reusing the address spuriously.
+    void set() noexcept {
+        if (state_.exchange(done, std::memory_order_acq_rel) == sleeping)
+            sys::impl::futex_wake_all(state_);
+    }
+
+    void wait() noexcept {
+        auto state = unset;
+        if (!state_.compare_exchange_strong(state, sleeping, std::memory_order_acquire, std::memory_order_acquire) && state == done)
+            return;
+        while (state_.load(std::memory_order_acquire) == sleeping)
+            sys::impl::futex_wait(state_, sleeping);
+    }
+};
+
+// A job living in the frame of the thread that waits for it, running a callable owned by that
+// frame too, so pushing one allocates nothing.
+template<class F>
+class StackJob final : public Job {
+    using Res = decltype(thread::impl::catch_unwind(std::declval<F&>()));
+
+    F& f_;
+    option::Option<Res> result_ = option::None;
+
+    static void run(Job* const job) {
+        auto* const self = static_cast<StackJob*>(job);
+        self->result_ = option::Some<Res>(thread::impl::catch_unwind(self->f_));
+        self->latch.set();
+    }
+
+public:
+    JobLatch latch;
+
+    explicit StackJob(F& f) noexcept : Job{&StackJob::run}, f_{f} {}
+
+    // The job was taken back before anyone else ran it.
+    Res run_inline() { return thread::impl::catch_unwind(f_); }
+
+    // Only once the latch is set.
+    Res take() { return std::move(result_).unwrap(); }
+};
+
+struct Worker {
+    sync::WorkDeque<Job*> deque;
+    ThreadPool* const pool;
+    std::size_t const index;
+    std::uint64_t rng;
+
+    Worker(ThreadPool* const p, std::size_t const i) : pool{p}, index{i}, rng{0x9e3779b97f4a7c15ull * (i + 1)} {}
+
+    // xorshift64*, for picking victims
+    std::uint64_t next_random() noexcept {
+        rng ^= rng >> 12;
+        rng ^= rng << 25;
+        rng ^= rng >> 27;
+        return rng * 0x2545f4914f6cdd1dull;
+    }
+};
+
+// constant-initialized, so reading it needs no TLS init guard
+inline thread_local Worker* current_worker = nullptr;
+
+template<class A, class B>
+using join_pair_t = std::pair<thread::impl::spawn_result_t<A&>, thread::impl::spawn_result_t<B&>>;
+
+template<class A, class B>
+using join_result_t = result::Result<join_pair_t<A, B>, thread::PanicPayload>;
+
+} // namespace detail
+
+// A fixed set of worker threads running fork-join work. Each worker has its own deque; idle
+// workers steal from random victims and sleep on an eventcount when there is nothing to steal.
+//
+// Panics in tasks are caught and come back as an Err with the payload where the task is joined.
+class ThreadPool {
+    std::vector<std::unique_ptr<detail::Worker>> workers_;
+    sync::SegQueue<detail::Job*> injected_; // jobs from threads outside the pool
+    sync::EventCount sleep_;
+    std::atomic<bool> terminate_{false};
+    std::vector<thread::JoinHandle<unit_t>> threads_;
+
+    static void execute(detail::Job* const job) { job->execute(job); }
+
+    // Own deque first, then jobs from outside, then other workers'.
+    detail::Job* find_work(detail::Worker& worker) noexcept {
+        if (auto job = worker.deque.pop(); job.is_some())
+            return std::move(job).unwrap();
+        if (auto job = injected_.pop(); job.is_some())
+            return std::move(job).unwrap();
+        auto const n = workers_.size();
+        for (;;) {
+            bool retry = false;
+            auto const start = static_cast<std::size_t>(worker.next_random() % n);
+            for (std::size_t i = 0; i < n; ++i) {
+                auto const victim = (start + i) % n;
+                if (victim == worker.index)
+                    continue;
+                auto const stolen = workers_[victim]->deque.steal();
+                if (stolen.status == sync::StealStatus::Success)
+                    return stolen.value;
+                retry |= stolen.status == sync::StealStatus::Retry;
+            }
+            if (!retry)
+                return nullptr;
+        }
+    }
+
+    void main_loop(detail::Worker& worker) {
+        detail::current_worker = &worker;
+        while (!terminate_.load(std::memory_order_acquire)) {
+            if (auto* const job = find_work(worker)) {
+                execute(job);
+                continue;
+            }
+            sys::spin::Yield<64, 16> spin{};
+            detail::Job* job = nullptr;
+            while (!job && spin.spin())
+                job = find_work(worker);
+            if (job) {
+                execute(job);
+                continue;
+            }
+            auto const key = sleep_.prepare_wait();
+            if ((job = find_work(worker))) {
+                sleep_.cancel_wait();
+                execute(job);
+                continue;
+            }
+            if (terminate_.load(std::memory_order_acquire)) {
+                sleep_.cancel_wait();
+                break;
+            }
+            sleep_.wait(key);
+        }
+        detail::current_worker = nullptr;
+    }
+
+    // Helps with other work until `latch` is set, then sleeps on it once there is none.
+    void wait_until(detail::Worker& worker, detail::JobLatch& latch) {
+        sys::spin::Yield<64, 16> spin{};
+        while (!latch.probe()) {
+            if (auto* const job = find_work(worker)) {
+                execute(job);
+                spin = {};
+            } else if (!spin.spin()) {
+                latch.wait();
+                return;
+            }
+        }
+    }
+
+    template<class A, class B>
+    detail::join_result_t<A, B> join_on(detail::Worker& worker, A& a, B& b) {
+        using Pair = detail::join_pair_t<A, B>;
+        detail::StackJob<B> job_b(b);
+        worker.deque.push(&job_b);
+        sleep_.notify();
+        auto ra = thread::impl::catch_unwind(a);
+
+        // b is still on top of our deque unless a thief took it, or we ran it helping out below
+        auto rb = [&] {
+            while (!job_b.latch.probe()) {
+                auto job = worker.deque.pop();
+                if (job.is_none()) {
+                    wait_until(worker, job_b.latch);
+                    break;
+                }
+                auto* const next = std::move(job).unwrap();
+                if (next == &job_b)
+                    return job_b.run_inline();
+                execute(next);
+            }
+            return job_b.take();
+        }();
+
+        if (ra.is_err())
+            return result::Err<Pair, thread::PanicPayload>(std::move(ra).unwrap_err());
+        if (rb.is_err())
+            return result::Err<Pair, thread::PanicPayload>(std::move(rb).unwrap_err());
+        return result::Ok<Pair, thread::PanicPayload>(std::move(ra).unwrap(), std::move(rb).unwrap());
+    }
+
+public:
+    // One worker per core when `num_threads` is 0.
+    explicit ThreadPool(std::size_t num_threads = 0) {
+        if (num_threads == 0)
+            num_threads = std::max(1u, std::thread::hardware_concurrency());
+        workers_.reserve(num_threads);
+        for (std::size_t i = 0; i < num_threads; ++i)
+            workers_.push_back(std::make_unique<detail::Worker>(this, i));
+        threads_.reserve(num_threads);
+        for (auto& worker : workers_) {
+            threads_.push_back(thread::Builder{}
+                .name("pool-worker-" + std::to_string(worker->index))
+                .spawn([this, w = worker.get()] { main_loop(*w); })
+                .expect("failed to spawn pool worker"));
+        }
+    }
+
+    ThreadPool(ThreadPool const&) = delete;
+    ThreadPool& operator=(ThreadPool const&) = delete;
+
+    // Waits for the workers to finish what they are running and exit.
+    ~ThreadPool() {
+        terminate_.store(true, std::memory_order_release);
+        sleep_.notify_all();
+        for (auto& t : threads_)
+            (void)std::move(t).join();
+    }
+
+    [[nodiscard]] std::size_t num_threads() const noexcept { return workers_.size(); }
+
+    // Runs `f` on a worker of this pool and waits for it. Called from one of them, runs it inline.
+    template<class F>
+    auto install(F&& f) -> decltype(thread::impl::catch_unwind(f)) {
+        if (auto* const worker = detail::current_worker; worker && worker->pool == this)
+            return thread::impl::catch_unwind(f);
+        detail::StackJob<std::remove_reference_t<F>> job(f);
+        injected_.push(&job);
+        sleep_.notify();
+        job.latch.wait();
+        return job.take();
+    }
+
+    // Runs `a` and `b`, potentially in parallel, and returns both results. `b` is offered to
+    // other workers while `a` runs and runs inline afterwards if nobody took it. If either one
+    // panicked, returns the payload of the first, after both finished.
+    template<class A, class B>
+    detail::join_result_t<std::remove_reference_t<A>, std::remove_reference_t<B>> join(A&& a, B&& b) {
+        using Pair = detail::join_pair_t<std::remove_reference_t<A>, std::remove_reference_t<B>>;
+        if (auto* const worker = detail::current_worker; worker && worker->pool == this)
+            return join_on(*worker, a, b);
+        auto res = install([&] { return join_on(*detail::current_worker, a, b); });
+        if (res.is_err())
+            return result::Err<Pair, thread::PanicPayload>(std::move(res).unwrap_err());
+        return std::move(res).unwrap();
+    }
+};
+
+// The pool used outside of any other, with a worker per core. Created on first use and never
+// destroyed, so its workers may outlive static destructors.
+inline ThreadPool& global() {
+    static ThreadPool* const pool = new ThreadPool();
+    return *pool;
+}
+
+// The pool the calling thread works for, or the global pool.
+inline ThreadPool& current() {
+    if (auto* const worker = detail::current_worker)
+        return *worker->pool;
+    return global();
+}
+
+[[nodiscard]] inline std::size_t current_num_threads() { return current().num_threads(); }
+
+// `ThreadPool::join` on the current pool.
+template<class A, class B>
+auto join(A&& a, B&& b) {
+    return current().join(std::forward<A>(a), std::forward<B>(b));
+}
+
+} // namespace pool
+} // namespace rust
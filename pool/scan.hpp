@@ -0,0 +1,102 @@
+// scan.hpp
+
+#pragma once
+
+#include "../_detail.hpp"
+#include "par_iter.hpp"
+#include "pool.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <functional>
+#include <iterator>
+#include <numeric>
+#include <utility>
+#include <vector>
+
+namespace rust {
+namespace pool {
+
+namespace detail {
+
+// blocks shorter than this are not worth a pass of their own
+inline constexpr std::size_t scan_min_block = 4096;
+
+// A scan in three passes over a fixed partition into blocks: the blocks are reduced in parallel,
+// the block sums scanned serially into each block's carry in, and then the blocks scanned in
+// parallel from it. The first block gets `init`, which is null for an inclusive scan.
+template<class T, class Op, class Block>
+void blocked_scan(T const* const in, std::size_t const n, Op const& op, T const* const init, Block const& block) {
+    auto const blocks = std::min(n / scan_min_block, 4 * current_num_threads());
+    auto const bounds = [&](std::size_t const b) { return std::pair{b * n / blocks, (b + 1) * n / blocks}; };
+
+    auto const sums = run(blocks, 1, [&](std::size_t const lo, std::size_t const hi) {
+        std::vector<T> out;
+        out.reserve(hi - lo);
+        for (auto b = lo; b < hi; ++b) {
+            auto const [first, last] = bounds(b);
+            out.push_back(std::accumulate(in + first + 1, in + last, in[first], op));
+        }
+        return out;
+    }, [](std::vector<T> left, std::vector<T> right) { return append(std::move(left), std::move(right)); });
+
+    // carries[b] goes into block b + 1
+    std::vector<T> carries;
+    carries.reserve(blocks - 1);
+    carries.push_back(init ? op(*init, sums[0]) : sums[0]);
+    for (std::size_t b = 1; b + 1 < blocks; ++b)
+        carries.push_back(op(carries.back(), sums[b]));
+
+    run(blocks, 1, [&](std::size_t const lo, std::size_t const hi) {
+        for (auto b = lo; b < hi; ++b) {
+            auto const [first, last] = bounds(b);
+            block(first, last, b == 0 ? init : &carries[b - 1]);
+        }
+        return unit_t{};
+    }, combine_units);
+}
+
+} // namespace detail
+
+// Writes to `out[i]` the fold with `op` of `in[0]` through `in[i]`, on the current pool. `op`
+// must be associative, since the blocks are folded apart before being combined.
+template<class T, class Op = std::plus<>>
+void par_inclusive_scan(T const* const in, std::size_t const n, T* const out, Op const op = {}) {
+    if (n < 2 * detail::scan_min_block) {
+        std::inclusive_scan(in, in + n, out, op);
+        return;
+    }
+    detail::blocked_scan(in, n, op, static_cast<T const*>(nullptr),
+        [&](std::size_t const first, std::size_t const last, T const* const carry) {
+            if (carry)
+                std::inclusive_scan(in + first, in + last, out + first, op, *carry);
+            else
+                std::inclusive_scan(in + first, in + last, out + first, op);
+        });
+}
+
+// In place.
+template<class C, class Op = std::plus<>>
+void par_inclusive_scan(C& c, Op op = {}) { par_inclusive_scan(std::data(c), std::size(c), std::data(c), std::move(op)); }
+
+// Writes to `out[i]` the fold with `op` of `init` and `in[0]` through `in[i - 1]`, so `out[0]`
+// is `init`, on the current pool. `op` must be associative.
+template<class T, class Op = std::plus<>>
+void par_exclusive_scan(T const* const in, std::size_t const n, T* const out, rust::detail::type_identity_t<T> init, Op const op = {}) {
+    if (n < 2 * detail::scan_min_block) {
+        std::exclusive_scan(in, in + n, out, std::move(init), op);
+        return;
+    }
+    detail::blocked_scan(in, n, op, &init,
+        [&](std::size_t const first, std::size_t const last, T const* const carry) {
+            std::exclusive_scan(in + first, in + last, out + first, *carry, op);
+        });
+}
+
+template<class C, class Op = std::plus<>>
+void par_exclusive_scan(C& c, rust::detail::remove_cvref_t<decltype(*std::data(c))> init, Op op = {}) {
+    par_exclusive_scan(std::data(c), std::size(c), std::data(c), std::move(init), std::move(op));
+}
+
+} // namespace pool
+} // namespace rust
@@ -0,0 +1,191 @@
+// sort.hpp
+
+#pragma once
+
+#include "../option.hpp"
+#include "pool.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <functional>
+#include <iterator>
+#include <utility>
+#include <vector>
+
+namespace rust {
+namespace pool {
+
+namespace detail {
+
+// below these lengths a piece is sorted or merged serially
+inline constexpr std::size_t sort_leaf_len = 2048;
+inline constexpr std::size_t merge_leaf_len = 4096;
+
+template<class A, class B>
+void join_or_resume(A&& a, B&& b) {
+    auto res = current().join(std::forward<A>(a), std::forward<B>(b));
+    if (res.is_err())
+        thread::impl::resume_unwind(std::move(res).unwrap_err());
+}
+
+template<class F>
+void install_or_resume(F&& f) {
+    auto res = current().install(std::forward<F>(f));
+    if (res.is_err())
+        thread::impl::resume_unwind(std::move(res).unwrap_err());
+}
+
+// Merges the sorted runs `a` and `b` into `out` by moving, elements of `a` before equal ones of
+// `b`. The larger run is cut in half and the other one where its middle element would go, so
+// both halves can be merged in parallel.
+template<class T, class Cmp>
+void par_merge(T* const a, std::size_t const na, T* const b, std::size_t const nb, T* const out, Cmp const& cmp) {
+    if (na + nb <= merge_leaf_len) {
+        std::merge(std::make_move_iterator(a), std::make_move_iterator(a + na),
+                   std::make_move_iterator(b), std::make_move_iterator(b + nb), out, cmp);
+        return;
+    }
+    std::size_t ma, mb;
+    if (na >= nb) {
+        ma = na / 2;
+        mb = static_cast<std::size_t>(std::lower_bound(b, b + nb, a[ma], cmp) - b);
+    } else {
+        mb = nb / 2;
+        ma = static_cast<std::size_t>(std::upper_bound(a, a + na, b[mb], cmp) - a);
+    }
+    join_or_resume(
+        [&] { par_merge(a, ma, b, mb, out, cmp); },
+        [&] { par_merge(a + ma, na - ma, b + mb, nb - mb, out + ma + mb, cmp); });
+}
+
+// Sorts `src` stably, leaving the result in `dst` if `into_dst` and in `src` otherwise. The
+// halves are sorted into the other buffer, so every level merges once and moves nothing back.
+template<class T, class Cmp>
+void merge_sort(T* const src, T* const dst, std::size_t const n, bool const into_dst, Cmp const& cmp) {
+    if (n <= sort_leaf_len) {
+        std::stable_sort(src, src + n, cmp);
+        if (into_dst)
+            std::move(src, src + n, dst);
+        return;
+    }
+    auto const mid = n / 2;
+    join_or_resume(
+        [&] { merge_sort(src, dst, mid, !into_dst, cmp); },
+        [&] { merge_sort(src + mid, dst + mid, n - mid, !into_dst, cmp); });
+    if (into_dst)
+        par_merge(src, mid, src + mid, n - mid, dst, cmp);
+    else
+        par_merge(dst, mid, dst + mid, n - mid, src, cmp);
+}
+
+template<class T, class Cmp>
+T* median_of_three(T* a, T* b, T* const c, Cmp const& cmp) {
+    if (cmp(*b, *a))
+        std::swap(a, b);
+    if (!cmp(*c, *b))
+        return b;
+    return cmp(*c, *a) ? a : c;
+}
+
+// Quicksort recursing on both sides in parallel. Past `budget` bad splits the piece is left to
+// std::sort, which bounds the worst case the same way introsort does.
+template<class T, class Cmp>
+void quick_sort(T* const data, std::size_t const n, Cmp const& cmp, unsigned const budget) {
+    if (n <= sort_leaf_len || budget == 0) {
+        std::sort(data, data + n, cmp);
+        return;
+    }
+    std::iter_swap(data, median_of_three(data, data + n / 2, data + n - 1, cmp));
+    auto* const split = std::partition(data + 1, data + n, [&](T const& x) { return cmp(x, *data); });
+    auto* const pivot = split - 1;
+    std::iter_swap(data, pivot);
+    auto* right = pivot + 1;
+    // the pivot was the smallest: skip the elements equal to it, or many duplicates never split
+    if (pivot == data)
+        right = std::partition(right, data + n, [&](T const& x) { return !cmp(*pivot, x); });
+    auto const unbalanced = std::min<std::size_t>(pivot - data, data + n - right) < n / 8;
+    auto const next = unbalanced ? budget - 1 : budget;
+    join_or_resume(
+        [&] { quick_sort(data, static_cast<std::size_t>(pivot - data), cmp, next); },
+        [&] { quick_sort(right, static_cast<std::size_t>(data + n - right), cmp, next); });
+}
+
+inline unsigned floor_log2(std::size_t n) noexcept {
+    unsigned r = 0;
+    while (n >>= 1)
+        ++r;
+    return r;
+}
+
+// Orders Some before None and Somes by `cmp` on their values.
+template<class Cmp>
+struct NonesLast {
+    Cmp cmp;
+
+    template<class T>
+    bool operator()(option::Option<T> const& a, option::Option<T> const& b) const {
+        if (a.is_none())
+            return false;
+        if (b.is_none())
+            return true;
+        // Option only hands out its value mutably, and the elements being sorted are never const
+        auto& x = const_cast<option::Option<T>&>(a);
+        auto& y = const_cast<option::Option<T>&>(b);
+        return x.as_mut().map_or([&](T& l) {
+            return y.as_mut().map_or([&](T& r) { return bool(cmp(std::as_const(l), std::as_const(r))); }, false);
+        }, false);
+    }
+};
+
+} // namespace detail
+
+// Sorts stably on the current pool with a parallel merge sort. Needs a buffer of `n` elements,
+// so T must be move constructible as well as move assignable. If `cmp` panics, the panic continues
+// on the caller with the elements in an unspecified, moved-from state.
+template<class T, class Cmp = std::less<>>
+void par_sort(T* const data, std::size_t const n, Cmp const cmp = {}) {
+    if (n <= detail::sort_leaf_len) {
+        std::stable_sort(data, data + n, cmp);
+        return;
+    }
+    std::vector<T> buf(std::make_move_iterator(data), std::make_move_iterator(data + n));
+    detail::install_or_resume([&] { detail::merge_sort(buf.data(), data, n, true, cmp); });
+}
+
+template<class C, class Cmp = std::less<>>
+void par_sort(C& c, Cmp cmp = {}) { par_sort(std::data(c), std::size(c), std::move(cmp)); }
+
+// Sorts in place on the current pool with a parallel quicksort. Equal elements may be reordered.
+template<class T, class Cmp = std::less<>>
+void par_sort_unstable(T* const data, std::size_t const n, Cmp const cmp = {}) {
+    if (n <= detail::sort_leaf_len) {
+        std::sort(data, data + n, cmp);
+        return;
+    }
+    detail::install_or_resume([&] { detail::quick_sort(data, n, cmp, 2 * detail::floor_log2(n)); });
+}
+
+template<class C, class Cmp = std::less<>>
+void par_sort_unstable(C& c, Cmp cmp = {}) { par_sort_unstable(std::data(c), std::size(c), std::move(cmp)); }
+
+// Sorts Options with the values in order by `cmp` and every None after them, in the same pass.
+template<class T, class Cmp = std::less<>>
+void par_sort_nones_last(option::Option<T>* const data, std::size_t const n, Cmp cmp = {}) {
+    par_sort(data, n, detail::NonesLast<Cmp>{std::move(cmp)});
+}
+
+template<class C, class Cmp = std::less<>>
+void par_sort_nones_last(C& c, Cmp cmp = {}) { par_sort_nones_last(std::data(c), std::size(c), std::move(cmp)); }
+
+template<class T, class Cmp = std::less<>>
+void par_sort_unstable_nones_last(option::Option<T>* const data, std::size_t const n, Cmp cmp = {}) {
+    par_sort_unstable(data, n, detail::NonesLast<Cmp>{std::move(cmp)});
+}
+
+template<class C, class Cmp = std::less<>>
+void par_sort_unstable_nones_last(C& c, Cmp cmp = {}) {
+    par_sort_unstable_nones_last(std::data(c), std::size(c), std::move(cmp));
+}
+
+} // namespace pool
+} // namespace rust
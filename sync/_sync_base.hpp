@@ -5,9 +5,12 @@
 #include "../_detail.hpp"
 #include "../result.hpp"
 #include "../thread/thread.hpp"
+#include "cancel.hpp"
 
 #include <atomic>
 #include <functional>
+#include <memory>
+#include <new>
 #include <utility>
 
 namespace rust {
@@ -38,52 +41,68 @@ struct WouldBlock_t{ constexpr WouldBlock_t() noexcept = default; };
 static constexpr WouldBlock_t WouldBlock{};
 
 namespace {
-template<class T>
-struct TryLockError_storage_base {
+// either `Tag`, the reason the lock wasn't taken, or a PoisonError
+template<class T, class Tag, bool IsTriviallyDestructible>
+struct TryLockError_storage {
     union {
-        WouldBlock_t blocked_;
+        Tag blocked_;
         PoisonError<T> poison_;
     };
     bool is_blocked_;
     
-    TryLockError_storage_base(WouldBlock_t)
+    TryLockError_storage(Tag)
         : blocked_{}
         , is_blocked_{true}
     {}
 
     template<class... Args>
-    TryLockError_storage_base(poison_tag_t, Args&&... args)
+    TryLockError_storage(poison_tag_t, Args&&... args)
         : poison_(std::forward<Args>(args)...)
         , is_blocked_{false}
     {}
 };
 
-template<class T, bool IsTriviallyDestructible>
-struct TryLockError_storage : public TryLockError_storage_base<T> {
-    using base = TryLockError_storage_base<T>;
+// guards are move-only and unlock on destruction, so the active member has to be managed by hand
+template<class T, class Tag>
+struct TryLockError_storage<T, Tag, false> {
+    union {
+        Tag blocked_;
+        PoisonError<T> poison_;
+    };
+    bool is_blocked_;
+    
+    TryLockError_storage(Tag)
+        : blocked_{}
+        , is_blocked_{true}
+    {}
 
     template<class... Args>
-    TryLockError_storage(Args&&... args) : base(std::forward<Args>(args)...) {}
-};
+    TryLockError_storage(poison_tag_t, Args&&... args)
+        : poison_(std::forward<Args>(args)...)
+        , is_blocked_{false}
+    {}
 
-template<class T>
-struct TryLockError_storage<T, false> : public TryLockError_storage_base<T> {
-    using base = TryLockError_storage_base<T>;
-    
-    template<class... Args>
-    TryLockError_storage(Args&&... args) : base(std::forward<Args>(args)...) {}
+    TryLockError_storage(TryLockError_storage&& other) 
+        : blocked_{}
+        , is_blocked_{other.is_blocked_}
+    {
+        if (!is_blocked_)
+            new(std::addressof(poison_)) PoisonError<T>(std::move(other.poison_));
+    }
+
+    TryLockError_storage& operator=(TryLockError_storage&&) = delete;
 
     ~TryLockError_storage() {
-        if (!this->is_blocked_)
-            this->poison_.~PoisonError<T>();
+        if (!is_blocked_)
+            poison_.~PoisonError<T>();
     }
 };
 
 } // namespace
 
 template<class Guard>
-class TryLockError : private TryLockError_storage<Guard, std::is_trivially_destructible_v<Guard>> {
-    using storage = TryLockError_storage<Guard, std::is_trivially_destructible_v<Guard>>;
+class TryLockError : private TryLockError_storage<Guard, WouldBlock_t, std::is_trivially_destructible_v<Guard>> {
+    using storage = TryLockError_storage<Guard, WouldBlock_t, std::is_trivially_destructible_v<Guard>>;
 public:
     template<class... Args, detail::enable_variadic_ctr<TryLockError<Guard>, Args...> = 0>
     constexpr explicit TryLockError(Args&&... args)
@@ -100,14 +119,14 @@ public:
     template<class... Fns>
     [[nodiscard]] constexpr auto match(Fns&&... fns) const& {
         if (this->is_blocked_)
-            return std::invoke(rust::detail::overloaded{std::forward<Fns>(fns)...}, WouldBlock{});
+            return std::invoke(rust::detail::overloaded{std::forward<Fns>(fns)...}, WouldBlock);
         return std::invoke(rust::detail::overloaded{std::forward<Fns>(fns)...}, this->poison_);
     }
 
     template<class... Fns>
     [[nodiscard]] constexpr auto match(Fns&&... fns) && {
         if (this->is_blocked_)
-            return std::invoke(rust::detail::overloaded{std::forward<Fns>(fns)...}, WouldBlock{});
+            return std::invoke(rust::detail::overloaded{std::forward<Fns>(fns)...}, WouldBlock);
         return std::invoke(rust::detail::overloaded{std::forward<Fns>(fns)...}, std::move(this->poison_));
     }
 
@@ -115,11 +134,46 @@ public:
     [[nodiscard]] constexpr bool is_poisoned() { return !this->is_blocked_; }
 };
 
+// Waiting for the lock was canceled, or the lock is poisoned.
+template<class Guard>
+class CancelLockError : private TryLockError_storage<Guard, Canceled_t, std::is_trivially_destructible_v<Guard>> {
+    using storage = TryLockError_storage<Guard, Canceled_t, std::is_trivially_destructible_v<Guard>>;
+public:
+    template<class... Args, detail::enable_variadic_ctr<CancelLockError<Guard>, Args...> = 0>
+    constexpr explicit CancelLockError(Args&&... args)
+        : storage(std::forward<Args>(args)...)
+    {}
+
+    CancelLockError(CancelLockError&&) = default;
+
+    template<class... Fns>
+    [[nodiscard]] constexpr auto match(Fns&&... fns) && {
+        if (this->is_blocked_)
+            return std::invoke(rust::detail::overloaded{std::forward<Fns>(fns)...}, Canceled);
+        return std::invoke(rust::detail::overloaded{std::forward<Fns>(fns)...}, std::move(this->poison_));
+    }
+
+    [[nodiscard]] constexpr bool is_canceled() const noexcept { return this->is_blocked_; }
+    [[nodiscard]] constexpr bool is_poisoned() const noexcept { return !this->is_blocked_; }
+};
+
+template<class T>
+using LockResult = result::Result<T, PoisonError<T>>;
+
+template<class T>
+using TryLockResult = result::Result<T, TryLockError<T>>;
+
+template<class T>
+using CancelLockResult = result::Result<T, CancelLockError<T>>;
+
 struct Guard { bool panicking; };
 
 class Flag {
     std::atomic_bool failed_{false};
 public:
+    constexpr Flag() noexcept = default;
+    constexpr explicit Flag(bool const failed) noexcept : failed_{failed} {}
+
     LockResult<Guard> borrow() const {
         auto const ret = Guard{thread::panicking()};
         return get() ? LockResult<Guard>(result::err_tag, ret) 
@@ -134,12 +188,5 @@ public:
     bool get() const { return failed_.load(std::memory_order_relaxed); }
 };
 
-template<class T>
-using LockResult = result::Result<T, PoisonError<T>>;
-
-template<class T>
-using TryLockResult = result::Result<T, TryLockError<T>>;
-
-
 } // namespace sync
 } // namespace rust
\ No newline at end of file
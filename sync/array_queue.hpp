@@ -0,0 +1,167 @@
+// array_queue.hpp
+
+#pragma once
+
+#include "../option.hpp"
+#include "../panic.hpp"
+#include "../result.hpp"
+#include "../sys/spin.hpp"
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <thread>
+#include <utility>
+
+namespace rust {
+namespace sync {
+
+// A bounded multi-producer multi-consumer queue in a ring buffer, after Dmitry Vyukov's design.
+//
+// Every slot has a stamp telling whether it is ready for the next push or the next pop, so
+// producers and consumers only contend on their own end's index. The head and tail indices
+// hold the position in the buffer below `one_lap`, the power of two above the capacity, and
+// count laps around it above that.
+template<class T>
+class ArrayQueue {
+    struct Slot {
+        std::atomic<std::size_t> stamp;
+        alignas(T) unsigned char storage[sizeof(T)];
+
+        T* value() noexcept { return std::launder(reinterpret_cast<T*>(storage)); }
+    };
+
+    alignas(64) std::atomic<std::size_t> head_{0};
+    alignas(64) std::atomic<std::size_t> tail_{0};
+    alignas(64) std::size_t cap_;
+    std::size_t one_lap_;
+    std::unique_ptr<Slot[]> buffer_;
+
+    std::size_t next_index(std::size_t const index) const noexcept {
+        auto const i = index & (one_lap_ - 1);
+        auto const lap = index & ~(one_lap_ - 1);
+        return i + 1 < cap_ ? index + 1 : lap + one_lap_;
+    }
+
+public:
+    // Panics if `capacity` is 0.
+    explicit ArrayQueue(std::size_t const capacity)
+        : cap_{capacity != 0 ? capacity : (panic("ArrayQueue capacity must be non-zero"), capacity)}
+        , one_lap_{[capacity] {
+            std::size_t lap = 1;
+            while (lap < capacity + 1)
+                lap <<= 1;
+            return lap;
+        }()}
+        , buffer_{new Slot[capacity]}
+    {
+        // a slot is ready to be pushed into when its stamp matches the tail
+        for (std::size_t i = 0; i < capacity; ++i)
+            buffer_[i].stamp.store(i, std::memory_order_relaxed);
+    }
+
+    ArrayQueue(ArrayQueue const&) = delete;
+    ArrayQueue& operator=(ArrayQueue const&) = delete;
+
+    ~ArrayQueue() {
+        auto const hix = head_.load(std::memory_order_relaxed) & (one_lap_ - 1);
+        for (std::size_t i = 0, n = len(); i < n; ++i) {
+            auto const index = hix + i < cap_ ? hix + i : hix + i - cap_;
+            buffer_[index].value()->~T();
+        }
+    }
+
+    // Gives `value` back if the queue is full.
+    result::Result<unit_t, T> push(T value) {
+        auto tail = tail_.load(std::memory_order_relaxed);
+        for (;;) {
+            auto& slot = buffer_[tail & (one_lap_ - 1)];
+            auto const stamp = slot.stamp.load(std::memory_order_acquire);
+            if (tail == stamp) {
+                if (tail_.compare_exchange_weak(tail, next_index(tail), std::memory_order_seq_cst, std::memory_order_relaxed)) {
+                    ::new (static_cast<void*>(slot.storage)) T(std::move(value));
+                    slot.stamp.store(tail + 1, std::memory_order_release);
+                    return result::Ok<unit_t, T>();
+                }
+                sys::spin_loop_hint();
+            }
+            else if (stamp + one_lap_ == tail + 1) {
+                // the slot still holds last lap's value: full unless the head moved on meanwhile
+                std::atomic_thread_fence(std::memory_order_seq_cst);
+                if (head_.load(std::memory_order_relaxed) + one_lap_ == tail)
+                    return result::Err<unit_t, T>(std::move(value));
+                sys::spin_loop_hint();
+                tail = tail_.load(std::memory_order_relaxed);
+            }
+            else {
+                // a consumer is midway through the slot
+                std::this_thread::yield();
+                tail = tail_.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    // None if the queue is empty.
+    [[nodiscard]] option::Option<T> pop() {
+        auto head = head_.load(std::memory_order_relaxed);
+        for (;;) {
+            auto& slot = buffer_[head & (one_lap_ - 1)];
+            auto const stamp = slot.stamp.load(std::memory_order_acquire);
+            if (head + 1 == stamp) {
+                if (head_.compare_exchange_weak(head, next_index(head), std::memory_order_seq_cst, std::memory_order_relaxed)) {
+                    auto value = option::Some<T>(std::move(*slot.value()));
+                    slot.value()->~T();
+                    slot.stamp.store(head + one_lap_, std::memory_order_release);
+                    return value;
+                }
+                sys::spin_loop_hint();
+            }
+            else if (stamp == head) {
+                // nothing was pushed into the slot yet: empty unless the tail moved on meanwhile
+                std::atomic_thread_fence(std::memory_order_seq_cst);
+                if (tail_.load(std::memory_order_relaxed) == head)
+                    return option::None;
+                sys::spin_loop_hint();
+                head = head_.load(std::memory_order_relaxed);
+            }
+            else {
+                // a producer is midway through the slot
+                std::this_thread::yield();
+                head = head_.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    [[nodiscard]] std::size_t capacity() const noexcept { return cap_; }
+
+    // a consistent snapshot of the number of values
+    [[nodiscard]] std::size_t len() const noexcept {
+        for (;;) {
+            auto const tail = tail_.load(std::memory_order_seq_cst);
+            auto const head = head_.load(std::memory_order_seq_cst);
+            if (tail_.load(std::memory_order_seq_cst) != tail)
+                continue;
+            auto const hix = head & (one_lap_ - 1);
+            auto const tix = tail & (one_lap_ - 1);
+            if (hix < tix)
+                return tix - hix;
+            if (hix > tix)
+                return cap_ - hix + tix;
+            return tail == head ? 0 : cap_;
+        }
+    }
+
+    [[nodiscard]] bool is_empty() const noexcept {
+        auto const head = head_.load(std::memory_order_seq_cst);
+        return tail_.load(std::memory_order_seq_cst) == head;
+    }
+
+    [[nodiscard]] bool is_full() const noexcept {
+        auto const tail = tail_.load(std::memory_order_seq_cst);
+        return head_.load(std::memory_order_seq_cst) + one_lap_ == tail;
+    }
+};
+
+} // namespace sync
+} // namespace rust
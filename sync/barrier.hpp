@@ -0,0 +1,33 @@
+// barrier.hpp
+
+#pragma once
+
+#include "../sys_common/barrier.hpp"
+
+#include <cstddef>
+
+namespace rust {
+namespace sync {
+
+class BarrierWaitResult {
+    bool const leader_;
+public:
+    constexpr explicit BarrierWaitResult(bool const leader) noexcept : leader_{leader} {}
+    // exactly one thread per phase is the leader
+    [[nodiscard]] constexpr bool is_leader() const noexcept { return leader_; }
+};
+
+// Lets `n` threads wait for each other, then releases them all together. Reusable across phases.
+class Barrier {
+    sys::Barrier<> barrier_;
+public:
+    explicit Barrier(std::size_t const n) : barrier_(n) {}
+
+    Barrier(Barrier const&) = delete;
+    Barrier& operator=(Barrier const&) = delete;
+
+    BarrierWaitResult wait() noexcept { return BarrierWaitResult{barrier_.wait()}; }
+};
+
+} // namespace sync
+} // namespace rust
@@ -0,0 +1,329 @@
+// broadcast.hpp
+
+#pragma once
+
+#include "../_include.hpp"
+#include "../result.hpp"
+#include "../sys/spin.hpp"
+#include "../sys_common/node_pool.hpp"
+#include "../sys_common/time.hpp"
+#include "mpsc/waker.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace rust {
+namespace sync {
+namespace broadcast {
+
+// ------------------------------------------------------------------------------------------
+// errors
+
+// The receiver fell behind and `missed` messages were overwritten before it read them.
+// The next receive returns the oldest message still in the ring.
+struct Lagged {
+    std::uint64_t missed;
+};
+
+struct empty_tag_t{ constexpr empty_tag_t() noexcept = default; };
+static constexpr empty_tag_t empty_tag{};
+
+struct closed_tag_t{ constexpr closed_tag_t() noexcept = default; };
+static constexpr closed_tag_t closed_tag{};
+
+// Why a receive failed: the receiver lagged, the ring is empty (only from try_recv or a timeout),
+// or the sender is gone and every message has been read.
+class RecvError {
+    enum class Kind { Lagged, Empty, Closed };
+
+    Kind kind_;
+    std::uint64_t missed_ = 0;
+
+public:
+    constexpr RecvError(Lagged const lagged) noexcept : kind_{Kind::Lagged}, missed_{lagged.missed} {}
+    constexpr RecvError(empty_tag_t) noexcept : kind_{Kind::Empty} {}
+    constexpr RecvError(closed_tag_t) noexcept : kind_{Kind::Closed} {}
+
+    [[nodiscard]] constexpr bool is_lagged() const noexcept { return kind_ == Kind::Lagged; }
+    [[nodiscard]] constexpr bool is_empty() const noexcept { return kind_ == Kind::Empty; }
+    [[nodiscard]] constexpr bool is_closed() const noexcept { return kind_ == Kind::Closed; }
+
+    // the number of overwritten messages, 0 unless lagged
+    [[nodiscard]] constexpr std::uint64_t missed() const noexcept { return missed_; }
+};
+
+// ------------------------------------------------------------------------------------------
+// ring
+
+namespace detail {
+
+using Spin = sys::spin::Yield<64, 16>;
+
+// A ring written by a single sender and read in place by any number of receivers, each with its
+// own cursor. Overwriting never waits: a message a receiver still holds is retired from the ring
+// and dropped once the receiver lets go, so at most one node per receiver exists beyond the
+// ring's capacity. A node's seq is the position + 1 of the message it holds.
+template<class T>
+class Shared {
+    using pool_t = sys::NodePool<T>;
+    using node_t = typename pool_t::Node;
+
+    alignas(64) std::atomic<std::uint64_t> tail_{0};
+    std::atomic<bool> closed_{false};
+    pool_t pool_;
+    alignas(64) std::atomic<std::size_t> refs_{1};
+    std::size_t cap_;
+    std::atomic<node_t*>* ring_;
+
+    static std::size_t round_up(std::size_t const n) noexcept {
+        std::size_t cap = 1;
+        while (cap < n)
+            cap <<= 1;
+        return cap;
+    }
+
+    std::atomic<node_t*>& slot(std::uint64_t const pos) noexcept { return ring_[pos & (cap_ - 1)]; }
+
+public:
+    using node_type = node_t;
+
+    mpsc::detail::Waker receivers;
+
+    explicit Shared(std::size_t const capacity) : cap_{round_up(capacity)}, ring_{new std::atomic<node_t*>[cap_]} {
+        for (std::size_t i = 0; i < cap_; ++i)
+            ring_[i].store(nullptr, std::memory_order_relaxed);
+    }
+
+    Shared(Shared const&) = delete;
+    Shared& operator=(Shared const&) = delete;
+
+    // no receiver is left to hold a node
+    ~Shared() {
+        for (std::size_t i = 0; i < cap_; ++i) {
+            auto* const node = ring_[i].load(std::memory_order_relaxed);
+            if (!node)
+                break;
+            pool_t::dispose(node);
+        }
+        delete[] ring_;
+    }
+
+    void acquire() noexcept { refs_.fetch_add(1, std::memory_order_relaxed); }
+
+    void release() noexcept {
+        if (refs_.fetch_sub(1, std::memory_order_acq_rel) == 1)
+            delete this;
+    }
+
+    [[nodiscard]] std::size_t capacity() const noexcept { return cap_; }
+    [[nodiscard]] std::uint64_t tail() const noexcept { return tail_.load(std::memory_order_acquire); }
+
+    // only called by the sender
+    void write(T&& msg) {
+        auto const pos = tail_.load(std::memory_order_relaxed);
+        auto& s = slot(pos);
+        if (auto* const old = s.load(std::memory_order_relaxed))
+            pool_.retire(old);
+        auto* const node = pool_.take();
+        ::new (static_cast<void*>(node->storage)) T(std::move(msg));
+        node->seq.store(pos + 1, std::memory_order_release);
+        s.store(node, std::memory_order_release);
+        tail_.store(pos + 1, std::memory_order_seq_cst);
+        receivers.notify_all();
+    }
+
+    void close() noexcept {
+        closed_.store(true, std::memory_order_seq_cst);
+        receivers.notify_all();
+    }
+
+    [[nodiscard]] bool is_ready(std::uint64_t const cursor) const noexcept {
+        return tail_.load(std::memory_order_seq_cst) != cursor || closed_.load(std::memory_order_seq_cst);
+    }
+
+    // Takes a reference to the message at `cursor` and advances it. Fails with Empty if nothing was
+    // sent since, and moves `cursor` up to the oldest message left if the receiver lagged.
+    result::Result<T const&, RecvError> try_read(std::uint64_t& cursor, node_t*& held) noexcept {
+        auto const tail = tail_.load(std::memory_order_acquire);
+        if (cursor == tail) {
+            // the close comes after the last message, which the tail above would have shown
+            if (closed_.load(std::memory_order_acquire) && tail_.load(std::memory_order_acquire) == cursor)
+                return result::Err<T const&, RecvError>(closed_tag);
+            return result::Err<T const&, RecvError>(empty_tag);
+        }
+        if (tail - cursor <= cap_) RUST_ATTR_LIKELY {
+            auto* const node = slot(cursor).load(std::memory_order_acquire);
+            if (node->acquire()) RUST_ATTR_LIKELY {
+                if (node->seq.load(std::memory_order_seq_cst) == cursor + 1) RUST_ATTR_LIKELY {
+                    held = node;
+                    ++cursor;
+                    return result::Ok<T const&, RecvError>(*node->value());
+                }
+                pool_.release(node);
+            }
+        }
+        // overwritten: skip to the oldest message, at least past the one being overwritten
+        auto const oldest = tail_.load(std::memory_order_acquire) - cap_;
+        auto const next = oldest > cursor ? oldest : cursor + 1;
+        auto const missed = next - cursor;
+        cursor = next;
+        return result::Err<T const&, RecvError>(Lagged{missed});
+    }
+
+    void release(node_t* const node) noexcept { pool_.release(node); }
+};
+
+} // namespace detail
+
+// ------------------------------------------------------------------------------------------
+// channel
+
+template<class T> class Sender;
+template<class T> class Receiver;
+
+template<class T>
+[[nodiscard]] std::pair<Sender<T>, Receiver<T>> channel(std::size_t capacity);
+
+// The single writing half of a broadcast channel. Every message is written once into the shared
+// ring and read in place by all receivers.
+template<class T>
+class Sender {
+    detail::Shared<T>* shared_;
+
+    constexpr explicit Sender(detail::Shared<T>* const shared) noexcept : shared_{shared} {}
+    friend std::pair<Sender<T>, Receiver<T>> channel<T>(std::size_t);
+
+public:
+    Sender(Sender&& other) noexcept : shared_{std::exchange(other.shared_, nullptr)} {}
+
+    Sender& operator=(Sender&& other) noexcept {
+        Sender tmp(std::move(other));
+        std::swap(shared_, tmp.shared_);
+        return *this;
+    }
+
+    Sender(Sender const&) = delete;
+    Sender& operator=(Sender const&) = delete;
+
+    // receivers read what is left in the ring, then get a closed error
+    ~Sender() {
+        if (shared_) {
+            shared_->close();
+            shared_->release();
+        }
+    }
+
+    // Never blocks. Once the ring is full, the oldest message is overwritten.
+    void send(T msg) { shared_->write(std::move(msg)); }
+
+    // A new receiver, seeing only messages sent from now on.
+    [[nodiscard]] Receiver<T> subscribe() const noexcept;
+
+    [[nodiscard]] std::size_t capacity() const noexcept { return shared_->capacity(); }
+};
+
+// A reading half of a broadcast channel. Copies read on independently from the same position.
+// A receiver is used by one thread at a time. A reference it returns stays valid until its next
+// receive or its destruction, however far the sender moves on meanwhile.
+template<class T>
+class Receiver {
+    using shared_t = detail::Shared<T>;
+
+    shared_t* shared_;
+    std::uint64_t cursor_;
+    typename shared_t::node_type* held_ = nullptr;
+
+    Receiver(shared_t* const shared, std::uint64_t const cursor) noexcept : shared_{shared}, cursor_{cursor} {}
+    friend class Sender<T>;
+    friend std::pair<Sender<T>, Receiver<T>> channel<T>(std::size_t);
+
+    void release_held() noexcept {
+        if (held_)
+            shared_->release(std::exchange(held_, nullptr));
+    }
+
+public:
+    Receiver(Receiver const& other) noexcept : shared_{other.shared_}, cursor_{other.cursor_} { shared_->acquire(); }
+    Receiver(Receiver&& other) noexcept
+        : shared_{std::exchange(other.shared_, nullptr)}
+        , cursor_{other.cursor_}
+        , held_{std::exchange(other.held_, nullptr)}
+    {}
+
+    Receiver& operator=(Receiver other) noexcept {
+        std::swap(shared_, other.shared_);
+        std::swap(cursor_, other.cursor_);
+        std::swap(held_, other.held_);
+        return *this;
+    }
+
+    ~Receiver() {
+        if (shared_) {
+            release_held();
+            shared_->release();
+        }
+    }
+
+    [[nodiscard]] Receiver clone() const noexcept { return *this; }
+
+    // Never blocks.
+    result::Result<T const&, RecvError> try_recv() noexcept {
+        release_held();
+        return shared_->try_read(cursor_, held_);
+    }
+
+    // Blocks until a message arrives. Fails if the receiver lagged, or once the sender is gone
+    // and every message has been read.
+    result::Result<T const&, RecvError> recv() noexcept {
+        return recv_deadline(std::chrono::steady_clock::time_point::max());
+    }
+
+    template<class Rep, class Period>
+    result::Result<T const&, RecvError> recv_timeout(std::chrono::duration<Rep, Period> const dur) noexcept {
+        return recv_deadline(sys::deadline_after(dur));
+    }
+
+    // Fails with an empty error if `deadline` passes first.
+    result::Result<T const&, RecvError> recv_deadline(std::chrono::steady_clock::time_point const deadline) noexcept {
+        release_held();
+        for (;;) {
+            detail::Spin spin{};
+            do {
+                auto res = shared_->try_read(cursor_, held_);
+                if (res.is_ok() || !res.unwrap_err_unsafe().is_empty())
+                    return res;
+            } while (spin.spin());
+            auto const cursor = cursor_;
+            if (!shared_->receivers.wait_until([this, cursor] { return shared_->is_ready(cursor); }, deadline))
+                return shared_->try_read(cursor_, held_);
+        }
+    }
+
+    // the number of messages sent that this receiver has not read yet, including overwritten ones
+    [[nodiscard]] std::uint64_t len() const noexcept { return shared_->tail() - cursor_; }
+    [[nodiscard]] bool is_empty() const noexcept { return len() == 0; }
+};
+
+template<class T>
+Receiver<T> Sender<T>::subscribe() const noexcept {
+    shared_->acquire();
+    return Receiver<T>{shared_, shared_->tail()};
+}
+
+// A broadcast channel keeping the last `capacity` messages, rounded up to a power of two.
+// `capacity` must not be 0.
+template<class T>
+[[nodiscard]] std::pair<Sender<T>, Receiver<T>> channel(std::size_t const capacity) {
+    auto* const shared = new detail::Shared<T>(capacity);
+    shared->acquire();
+    return {Sender<T>{shared}, Receiver<T>{shared, 0}};
+}
+
+} // namespace broadcast
+} // namespace sync
+} // namespace rust
@@ -0,0 +1,228 @@
+// cancel.hpp
+
+#pragma once
+
+#include "../_include.hpp"
+#include "../sys/futex.hpp"
+#include "../sys_common/mutex.hpp"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <thread>
+#include <utility>
+
+namespace rust {
+namespace sync {
+
+// The operation was canceled through a CancellationToken.
+struct Canceled_t{ constexpr Canceled_t() noexcept = default; };
+static constexpr Canceled_t Canceled{};
+
+class CancellationToken;
+
+namespace cancel {
+
+// Something to run when a token is canceled, in the token's list while registered.
+struct Node {
+    void (*fire)(Node*);
+    Node* prev = nullptr;
+    Node* next = nullptr;
+    bool linked = false;                // under the list's lock
+    std::atomic<std::uint32_t> done{0}; // set once `fire` returned, if a cancel took the node out
+};
+
+// Shared by a token and its clones. A child is itself a node in its parent's list.
+class State : Node {
+    std::atomic<bool> canceled_{false};
+    std::atomic<std::size_t> refs_{1};
+    sys::RawMutex<> lock_{};
+    Node* head_ = nullptr;
+    std::thread::id firing_{}; // the thread running the nodes, under the lock
+    State* const parent_;
+    bool in_parent_ = false;
+
+    static void fire_child(Node* const node) { static_cast<State*>(node)->cancel(); }
+
+    void unlink(Node* const node) noexcept {
+        if (node->prev)
+            node->prev->next = node->next;
+        else
+            head_ = node->next;
+        if (node->next)
+            node->next->prev = node->prev;
+        node->linked = false;
+    }
+
+public:
+    explicit State(State* const parent) : Node{&State::fire_child}, parent_{parent} {
+        if (parent_) {
+            parent_->acquire();
+            in_parent_ = parent_->add(this);
+            if (!in_parent_)
+                canceled_.store(true, std::memory_order_relaxed);
+        }
+    }
+
+    State(State const&) = delete;
+    State& operator=(State const&) = delete;
+
+    ~State() {
+        if (parent_) {
+            if (in_parent_)
+                parent_->remove(this);
+            parent_->release();
+        }
+    }
+
+    void acquire() noexcept { refs_.fetch_add(1, std::memory_order_relaxed); }
+
+    void release() noexcept {
+        if (refs_.fetch_sub(1, std::memory_order_acq_rel) == 1)
+            delete this;
+    }
+
+    [[nodiscard]] bool is_canceled(std::memory_order const order) const noexcept { return canceled_.load(order); }
+
+    // Returns false, leaving `node` out, if the token is canceled already.
+    bool add(Node* const node) {
+        lock_.raw_lock();
+        bool const open = !canceled_.load(std::memory_order_relaxed);
+        if (open) {
+            node->prev = nullptr;
+            node->next = head_;
+            if (head_)
+                head_->prev = node;
+            head_ = node;
+            node->linked = true;
+        }
+        lock_.raw_unlock();
+        return open;
+    }
+
+    // Takes an added `node` out. If a cancel took it out first, waits for it to have run, unless
+    // it's running on this very thread.
+    void remove(Node* const node) {
+        lock_.raw_lock();
+        if (node->linked) {
+            unlink(node);
+            lock_.raw_unlock();
+            return;
+        }
+        bool const elsewhere = firing_ != std::this_thread::get_id();
+        lock_.raw_unlock();
+        if (elsewhere) {
+            while (node->done.load(std::memory_order_acquire) == 0)
+                sys::impl::futex_wait(node->done, 0);
+        }
+    }
+
+    // Runs every node once, outside the lock so they may take locks of their own.
+    void cancel() {
+        lock_.raw_lock();
+        if (canceled_.load(std::memory_order_relaxed)) {
+            lock_.raw_unlock();
+            return;
+        }
+        canceled_.store(true, std::memory_order_seq_cst);
+        firing_ = std::this_thread::get_id();
+        while (auto* const node = head_) {
+            unlink(node);
+            lock_.raw_unlock();
+            node->fire(node);
+            // the node's owner may free it as soon as the store lands, the wake after it at worst
+            // hits some other waiter reusing the address spuriously
+            node->done.store(1, std::memory_order_release);
+            sys::impl::futex_wake(node->done);
+            lock_.raw_lock();
+        }
+        firing_ = std::thread::id{};
+        lock_.raw_unlock();
+    }
+};
+
+State& state(CancellationToken const& token) noexcept;
+
+// Wakes an operation blocked on a token once it is canceled, from `arm` until it's dropped.
+// `Wake` runs on the canceling thread and must not wait for anything the blocked thread holds.
+template<class Wake>
+class Waiter : Node {
+    State& state_;
+    Wake wake_;
+    bool armed_ = false;
+
+    static void fire(Node* const node) { static_cast<Waiter*>(node)->wake_(); }
+
+public:
+    Waiter(CancellationToken const& token, Wake wake) : Node{&Waiter::fire}, state_{state(token)}, wake_{std::move(wake)} {}
+
+    Waiter(Waiter const&) = delete;
+    Waiter& operator=(Waiter const&) = delete;
+
+    ~Waiter() {
+        if (armed_)
+            state_.remove(this);
+    }
+
+    // Before checking `canceled` and going to sleep. Returns false if the token is canceled already.
+    bool arm() { return armed_ = state_.add(this); }
+
+    // Ordered with the cancel, so an operation that sees false and then sleeps gets woken.
+    [[nodiscard]] bool canceled() const noexcept { return state_.is_canceled(std::memory_order_seq_cst); }
+};
+
+} // namespace cancel
+
+// Cancels blocking operations cooperatively, e.g. on shutdown:
+//
+//     auto msg = rx.recv(token); // Err(RecvTimeoutError::Canceled) once `token.cancel()` was called
+//
+// Clones share the cancellation and are a reference count away. Children are canceled with their
+// parent but can be canceled on their own, without affecting it.
+class CancellationToken {
+    cancel::State* state_;
+
+    constexpr explicit CancellationToken(cancel::State* const state) noexcept : state_{state} {}
+
+    friend cancel::State& cancel::state(CancellationToken const&) noexcept;
+
+public:
+    CancellationToken() : state_{new cancel::State(nullptr)} {}
+
+    CancellationToken(CancellationToken const& other) noexcept : state_{other.state_} {
+        if (state_)
+            state_->acquire();
+    }
+    CancellationToken(CancellationToken&& other) noexcept : state_{std::exchange(other.state_, nullptr)} {}
+
+    CancellationToken& operator=(CancellationToken other) noexcept {
+        std::swap(state_, other.state_);
+        return *this;
+    }
+
+    ~CancellationToken() {
+        if (state_)
+            state_->release();
+    }
+
+    [[nodiscard]] CancellationToken child_token() const { return CancellationToken{new cancel::State(state_)}; }
+
+    // Cancels this token and its children and wakes everything blocked on them. Operations not
+    // blocked see it at their next check. A moved-from token has nothing to cancel.
+    void cancel() const {
+        if (state_)
+            state_->cancel();
+    }
+
+    // A single relaxed load. A moved-from token is never canceled.
+    [[nodiscard]] bool is_canceled() const noexcept {
+        return state_ && state_->is_canceled(std::memory_order_relaxed);
+    }
+};
+
+namespace cancel {
+inline State& state(CancellationToken const& token) noexcept { return *token.state_; }
+} // namespace cancel
+
+} // namespace sync
+} // namespace rust
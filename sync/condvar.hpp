@@ -4,9 +4,11 @@
 
 #include <atomic>
 #include <chrono>
+#include <cstdint>
 #include <utility>
 
 #include "../sys_common/condvar.hpp"
+#include "../sys_common/time.hpp"
 #include "_sync_base.hpp"
 #include "mutex.hpp"
 #include "../panic.hpp"
@@ -26,44 +28,144 @@ class Condvar {
     std::atomic_uintptr_t mutex_{0};
     sys::Condvar cv_{};
 
-    void verify(sys::Mutex const& m) {
+    template<class M>
+    void verify(M const& m) {
         uintptr_t expected = 0;
-        auto const addr = reinterpret_cast<uintptr_t>(std::addressof(mutex_));
-        if (auto const n = mutex_.compare_exchange_strong(expected, addr, std::memory_order_seq_cst); n == 0 || n == addr)
+        auto const addr = reinterpret_cast<uintptr_t>(std::addressof(m));
+        if (mutex_.compare_exchange_strong(expected, addr, std::memory_order_seq_cst) || expected == addr)
             return;
-        else
-            panic("attempted to use a condition variable with two mutexes");
+        panic("attempted to use a condition variable with two mutexes");
+    }
+
+    template<class T, class P>
+    static LockResult<std::pair<MutexGuard<T, P>, WaitTimeoutResult>> timeout_result(MutexGuard<T, P>&& guard, bool const timed_out) {
+        using ok_t = std::pair<MutexGuard<T, P>, WaitTimeoutResult>;
+        using err_t = PoisonError<ok_t>;
+
+        if (P::poison && mutex::guard_lock(guard).is_poisoned())
+            return result::Err<ok_t, err_t>(std::move(guard), WaitTimeoutResult{timed_out});
+        return result::Ok<ok_t, err_t>(std::move(guard), WaitTimeoutResult{timed_out});
     }
 public:
-    template<class T>
-    LockResult<MutexGuard<T>> wait(MutexGuard<T>&& guard) {
-        using ok_t = MutexGuard<T>;
-        using err_t = PoisonError<MutexGuard<T>>;
+    constexpr Condvar() noexcept = default;
+
+    Condvar(Condvar const&) = delete;
+    Condvar& operator=(Condvar const&) = delete;
+
+    template<class T, class P>
+    LockResult<MutexGuard<T, P>> wait(MutexGuard<T, P>&& guard) {
+        using ok_t = MutexGuard<T, P>;
+        using err_t = PoisonError<MutexGuard<T, P>>;
         
-        sys::Mutex& lock = mutex::guard_lock(guard);
+        auto& lock = mutex::guard_lock(guard);
         verify(lock);
         cv_.wait(lock);
-        if (mutex::guard_poison(guard).get())
-            return result::Err<ok_t, err_t>(guard); 
-        return result::Ok<ok_t, err_t>(guard);
+        if (P::poison && lock.is_poisoned())
+            return result::Err<ok_t, err_t>(std::move(guard)); 
+        return result::Ok<ok_t, err_t>(std::move(guard));
     }
 
-    template<class T, class Fn>
-    LockResult<MutexGuard<T>> wait_until(MutexGuard<T>&& guard, Fn&& condition) {
-        auto g(guard);
+    template<class T, class P, class Fn>
+    LockResult<MutexGuard<T, P>> wait_until(MutexGuard<T, P>&& guard, Fn&& condition) {
+        auto g(std::move(guard));
         while (!condition(*g))
             g = wait(std::move(g)).unwrap();
-        return result::Ok<MutexGuard<T>, PoisonError<MutexGuard<T>>(std::move(g));
+        return result::Ok<MutexGuard<T, P>, PoisonError<MutexGuard<T, P>>>(std::move(g));
     }
 
-    template<class T>
-    LockResult<std::pair<MutexGuard<T>, bool>> wait_timeout_ms(MutexGuard<T>&& guard, std::uint32_t const ms);
+    // Like `wait`, but gives up once `token` is canceled, unlocking the mutex. The wait may end
+    // spuriously, also when some other waiter's token is canceled.
+    template<class T, class P>
+    CancelLockResult<MutexGuard<T, P>> wait(MutexGuard<T, P>&& guard, CancellationToken const& token) {
+        using ok_t = MutexGuard<T, P>;
+        using err_t = CancelLockError<MutexGuard<T, P>>;
 
-    template<class T, class Rep, class Period>
-    LockResult<std::pair<MutexGuard<T>, WaitTimeoutResult>> wait_timeout(MutexGuard<T>&& guard, std::chrono::duration<Rep, Period> const dur);
+        auto& lock = mutex::guard_lock(guard);
+        verify(lock);
+        if (!token.is_canceled()) RUST_ATTR_LIKELY {
+            cancel::Waiter waiter(token, [this] { cv_.interrupt(); });
+            if (waiter.arm()) {
+                cv_.wait_until(lock, std::chrono::steady_clock::time_point::max(), [&] { return waiter.canceled(); });
+                if (!waiter.canceled()) {
+                    if (P::poison && lock.is_poisoned())
+                        return result::Err<ok_t, err_t>(poison_tag, std::move(guard));
+                    return result::Ok<ok_t, err_t>(std::move(guard));
+                }
+            }
+        }
+        { auto const unlock = std::move(guard); }
+        return result::Err<ok_t, err_t>(Canceled);
+    }
+
+    template<class T, class P, class Fn>
+    CancelLockResult<MutexGuard<T, P>> wait_until(MutexGuard<T, P>&& guard, Fn&& condition, CancellationToken const& token) {
+        auto g(std::move(guard));
+        while (!condition(*g)) {
+            auto res = wait(std::move(g), token);
+            if (res.is_err())
+                return res;
+            g = std::move(res).unwrap();
+        }
+        return result::Ok<MutexGuard<T, P>, CancelLockError<MutexGuard<T, P>>>(std::move(g));
+    }
 
-    template<class T, class Rep, class Period, class Fn>
-    LockResult<std::pair<MutexGuard<T>, WaitTimeoutResult>> wait_timeout_until(MutexGuard<T>&& guard, std::chrono::duration<Rep, Period> const dur, Fn&& condition);
+    // Waits for a notification until `deadline` on the monotonic clock has passed.
+    // The wait may end spuriously, before the deadline and without a notification.
+    template<class T, class P>
+    LockResult<std::pair<MutexGuard<T, P>, WaitTimeoutResult>> wait_deadline(MutexGuard<T, P>&& guard, 
+        std::chrono::steady_clock::time_point const deadline) {
+        auto& lock = mutex::guard_lock(guard);
+        verify(lock);
+        bool const woken = cv_.wait_until(lock, deadline);
+        return timeout_result(std::move(guard), !woken);
+    }
+
+    // Waits until `condition` holds or `deadline` has passed, spurious wakeups don't end the wait.
+    // The deadline is fixed up front, so retries neither read the clock nor extend the total wait.
+    template<class T, class P, class Fn>
+    LockResult<std::pair<MutexGuard<T, P>, WaitTimeoutResult>> wait_deadline_until(MutexGuard<T, P>&& guard,
+        std::chrono::steady_clock::time_point const deadline, Fn&& condition) {
+        auto& lock = mutex::guard_lock(guard);
+        verify(lock);
+        bool timed_out = false;
+        while (!condition(*guard)) {
+            if (!cv_.wait_until(lock, deadline)) {
+                // the condition may have been met right as the deadline passed
+                timed_out = !condition(*guard);
+                break;
+            }
+            if (P::poison && lock.is_poisoned())
+                break;
+        }
+        return timeout_result(std::move(guard), timed_out);
+    }
+
+    // The returned bool is false only if the timeout is known to have elapsed.
+    template<class T, class P>
+    LockResult<std::pair<MutexGuard<T, P>, bool>> wait_timeout_ms(MutexGuard<T, P>&& guard, std::uint32_t const ms) {
+        using ok_t = std::pair<MutexGuard<T, P>, bool>;
+        using err_t = PoisonError<ok_t>;
+
+        auto res = wait_timeout(std::move(guard), std::chrono::milliseconds{ms});
+        if (res.is_ok()) {
+            auto& [g, t] = res.unwrap_unsafe();
+            return result::Ok<ok_t, err_t>(std::move(g), !t.timed_out());
+        }
+        auto& [g, t] = res.unwrap_err_unsafe().get_mut();
+        return result::Err<ok_t, err_t>(std::move(g), !t.timed_out());
+    }
+
+    template<class T, class P, class Rep, class Period>
+    LockResult<std::pair<MutexGuard<T, P>, WaitTimeoutResult>> wait_timeout(MutexGuard<T, P>&& guard, 
+        std::chrono::duration<Rep, Period> const dur) {
+        return wait_deadline(std::move(guard), sys::deadline_after(dur));
+    }
+
+    template<class T, class P, class Rep, class Period, class Fn>
+    LockResult<std::pair<MutexGuard<T, P>, WaitTimeoutResult>> wait_timeout_until(MutexGuard<T, P>&& guard, 
+        std::chrono::duration<Rep, Period> const dur, Fn&& condition) {
+        return wait_deadline_until(std::move(guard), sys::deadline_after(dur), std::forward<Fn>(condition));
+    }
 
     void notify_one() { cv_.notify_one(); }
     void notify_all() { cv_.notify_all(); }
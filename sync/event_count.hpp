@@ -0,0 +1,114 @@
+// event_count.hpp
+
+#pragma once
+
+#include "../_include.hpp"
+#include "../sys/futex.hpp"
+#include "../sys_common/time.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+namespace rust {
+namespace sync {
+
+// Lets threads sleep until a condition on some lock-free structure holds, without a lock on the
+// side that makes it true. A waiter announces itself, checks the condition and only then sleeps:
+//
+//     for (;;) {
+//         if (auto v = queue.pop()) return v;
+//         auto const key = ec.prepare_wait();
+//         if (auto v = queue.pop()) { ec.cancel_wait(); return v; }
+//         ec.wait(key);
+//     }
+//
+// and the other side notifies after changing the state. Notifying while nobody waits is a fence
+// and a single load, whatever ordering the state change itself used.
+class EventCount {
+    alignas(64) std::atomic<std::uint32_t> epoch_{0};
+    std::atomic<std::uint32_t> waiters_{0};
+
+    // the fences on both sides order the state change against `waiters_`: either the notifier
+    // sees the waiter, or the waiter's recheck sees the change
+    void notify_impl(bool const all) noexcept {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (waiters_.load(std::memory_order_relaxed) != 0) RUST_ATTR_UNLIKELY {
+            epoch_.fetch_add(1, std::memory_order_release);
+            if (all)
+                sys::impl::futex_wake_all(epoch_);
+            else
+                sys::impl::futex_wake(epoch_);
+        }
+    }
+
+public:
+    // The epoch seen by `prepare_wait`. Waiting on it returns as soon as anyone notified since.
+    class Key {
+        std::uint32_t epoch_;
+
+        constexpr explicit Key(std::uint32_t const epoch) noexcept : epoch_{epoch} {}
+        friend class EventCount;
+    };
+
+    constexpr EventCount() noexcept = default;
+
+    EventCount(EventCount const&) = delete;
+    EventCount& operator=(EventCount const&) = delete;
+
+    // Registers as a waiter. Must be followed by `cancel_wait` or `wait` with the returned key.
+    [[nodiscard]] Key prepare_wait() noexcept {
+        waiters_.fetch_add(1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        return Key{epoch_.load(std::memory_order_acquire)};
+    }
+
+    // The condition held after all.
+    void cancel_wait() noexcept { waiters_.fetch_sub(1, std::memory_order_relaxed); }
+
+    // Sleeps until notified after `prepare_wait`. May return spuriously, so callers check again.
+    void wait(Key const key) noexcept { wait_until(key, std::chrono::steady_clock::time_point::max()); }
+
+    // Returns false if `deadline` passed first.
+    bool wait_until(Key const key, std::chrono::steady_clock::time_point const deadline) noexcept {
+        bool notified = true;
+        while (epoch_.load(std::memory_order_acquire) == key.epoch_) {
+            if (!sys::impl::futex_wait_until(epoch_, key.epoch_, deadline)) {
+                notified = epoch_.load(std::memory_order_acquire) != key.epoch_;
+                break;
+            }
+        }
+        waiters_.fetch_sub(1, std::memory_order_relaxed);
+        return notified;
+    }
+
+    // Wakes one waiter.
+    void notify() noexcept { notify_impl(false); }
+
+    void notify_all() noexcept { notify_impl(true); }
+
+    // Blocks until `ready()` returns true, running the loop above.
+    template<class Ready>
+    void await(Ready&& ready) noexcept(noexcept(ready())) {
+        await_until(ready, std::chrono::steady_clock::time_point::max());
+    }
+
+    // Returns false if `deadline` passed while `ready()` still returned false.
+    template<class Ready>
+    bool await_until(Ready&& ready, std::chrono::steady_clock::time_point const deadline) noexcept(noexcept(ready())) {
+        for (;;) {
+            if (ready())
+                return true;
+            auto const key = prepare_wait();
+            if (ready()) {
+                cancel_wait();
+                return true;
+            }
+            if (!wait_until(key, deadline))
+                return ready();
+        }
+    }
+};
+
+} // namespace sync
+} // namespace rust
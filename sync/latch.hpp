@@ -0,0 +1,71 @@
+// latch.hpp
+
+#pragma once
+
+#include "../sys/futex.hpp"
+#include "../sys/spin.hpp"
+#include "../sys_common/time.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+namespace rust {
+namespace sync {
+
+// A single use countdown. Threads wait until it reaches zero, after which it stays open.
+class Latch {
+    static constexpr std::uint32_t parked = std::uint32_t{1} << 31; // a waiter may be asleep
+
+    // the count in the low bits, waiters set the parked bit
+    mutable std::atomic<std::uint32_t> state_;
+
+public:
+    // `count` must stay below 2^31
+    constexpr explicit Latch(std::uint32_t const count) noexcept : state_{count} {}
+
+    Latch(Latch const&) = delete;
+    Latch& operator=(Latch const&) = delete;
+
+    // Decrements the count by `n`, which must not exceed it, opening the latch at zero.
+    void count_down(std::uint32_t const n = 1) noexcept {
+        auto const prev = state_.fetch_sub(n, std::memory_order_release);
+        if (prev == (parked | n))
+            sys::impl::futex_wake_all(state_);
+    }
+
+    // Whether the count reached zero.
+    [[nodiscard]] bool try_wait() const noexcept { return (state_.load(std::memory_order_acquire) & ~parked) == 0; }
+
+    void wait() const noexcept { wait_deadline(std::chrono::steady_clock::time_point::max()); }
+
+    template<class Rep, class Period>
+    bool wait_timeout(std::chrono::duration<Rep, Period> const dur) const noexcept {
+        return wait_deadline(sys::deadline_after(dur));
+    }
+
+    // Returns false if `deadline` passed before the count reached zero.
+    bool wait_deadline(std::chrono::steady_clock::time_point const deadline) const noexcept {
+        sys::spin::Default spin{};
+        do {
+            if (try_wait())
+                return true;
+        } while (spin.spin());
+        for (;;) {
+            auto const current = state_.fetch_or(parked, std::memory_order_acquire) | parked;
+            if (current == parked)
+                return true;
+            if (!sys::impl::futex_wait_until(state_, current, deadline))
+                return try_wait();
+        }
+    }
+
+    // Counts down by `n` and waits for the rest.
+    void arrive_and_wait(std::uint32_t const n = 1) noexcept {
+        count_down(n);
+        wait();
+    }
+};
+
+} // namespace sync
+} // namespace rust
@@ -0,0 +1,147 @@
+// monitor.hpp
+
+#pragma once
+
+#include "../_detail.hpp"
+#include "../sys_common/time.hpp"
+#include "../sys_common/wait_queue.hpp"
+#include "_sync_base.hpp"
+#include "condvar.hpp"
+#include "mutex.hpp"
+#include "../panic.hpp"
+#include "../result.hpp"
+
+#include <chrono>
+#include <cstddef>
+#include <utility>
+
+namespace rust {
+namespace sync {
+
+// A Mutex whose waiters block on a key instead of a single condition variable.
+// notify(guard, key) only wakes the threads waiting on `key`, so threads waiting on
+// unrelated keys sleep through it instead of waking just to re-check their condition.
+// Notifying requires the guard: waiters register under the lock, so no wakeup can be lost.
+template<class T, class Key = std::size_t, class Policy = MutexPolicy<>>
+class Monitor {
+    using guard_t = MutexGuard<T, Policy>;
+    using queue_t = sys::KeyedWaitQueue<Key>;
+
+    Mutex<T, Policy> mutex_;
+    queue_t waiters_{}; // guarded by mutex_
+
+    // Sleeps on `node` with the lock released. Returns false if `deadline` passed first.
+    bool park(guard_t& guard, typename queue_t::Node& node, std::chrono::steady_clock::time_point const deadline) {
+        auto& lock = mutex::guard_lock(guard);
+        waiters_.push(node);
+        lock.raw_unlock();
+        bool const notified = node.wait_until(deadline);
+        lock.raw_lock();
+        // a notify may have come in between the timeout and retaking the lock
+        return notified || !waiters_.remove(node);
+    }
+
+    static bool is_poisoned(guard_t& guard) noexcept {
+        if constexpr (Policy::poison)
+            return mutex::guard_lock(guard).is_poisoned();
+        else
+            return false;
+    }
+
+    static LockResult<guard_t> lock_result(guard_t&& guard) {
+        using ok_t = guard_t;
+        using err_t = PoisonError<guard_t>;
+        if (is_poisoned(guard))
+            return result::Err<ok_t, err_t>(std::move(guard));
+        return result::Ok<ok_t, err_t>(std::move(guard));
+    }
+
+    static LockResult<std::pair<guard_t, WaitTimeoutResult>> timeout_result(guard_t&& guard, bool const timed_out) {
+        using ok_t = std::pair<guard_t, WaitTimeoutResult>;
+        using err_t = PoisonError<ok_t>;
+        if (is_poisoned(guard))
+            return result::Err<ok_t, err_t>(std::move(guard), WaitTimeoutResult{timed_out});
+        return result::Ok<ok_t, err_t>(std::move(guard), WaitTimeoutResult{timed_out});
+    }
+
+    // A guard of another mutex doesn't keep waiters of this one from registering during a notify.
+    void verify(guard_t const& guard) const {
+        if (&mutex::guard_mutex(guard) != &mutex_)
+            panic("attempted to notify a monitor with the guard of another mutex");
+    }
+
+public:
+    template<class... Args, rust::detail::enable_variadic_ctr<Monitor, Args...> = 0>
+    constexpr explicit Monitor(Args&&... args)
+        : mutex_(std::forward<Args>(args)...)
+    {}
+
+    Monitor(Monitor const&) = delete;
+    Monitor& operator=(Monitor const&) = delete;
+
+    [[nodiscard]] LockResult<guard_t> lock() noexcept { return mutex_.lock(); }
+    [[nodiscard]] TryLockResult<guard_t> try_lock() noexcept { return mutex_.try_lock(); }
+    [[nodiscard]] bool is_poisoned() const noexcept { return mutex_.is_poisoned(); }
+
+    // Blocks until `key` is notified.
+    LockResult<guard_t> wait(guard_t&& guard, Key const& key) {
+        typename queue_t::Node node{key};
+        park(guard, node, std::chrono::steady_clock::time_point::max());
+        return lock_result(std::move(guard));
+    }
+
+    // Blocks until `condition` holds, re-checking it only when `key` is notified.
+    template<class Fn>
+    LockResult<guard_t> wait_until(guard_t&& guard, Key const& key, Fn&& condition) {
+        while (!condition(*guard)) {
+            typename queue_t::Node node{key};
+            park(guard, node, std::chrono::steady_clock::time_point::max());
+            if (is_poisoned(guard))
+                break;
+        }
+        return lock_result(std::move(guard));
+    }
+
+    template<class Fn>
+    LockResult<std::pair<guard_t, WaitTimeoutResult>> wait_deadline_until(guard_t&& guard, Key const& key,
+        std::chrono::steady_clock::time_point const deadline, Fn&& condition) {
+        bool timed_out = false;
+        while (!condition(*guard)) {
+            typename queue_t::Node node{key};
+            if (!park(guard, node, deadline)) {
+                timed_out = !condition(*guard);
+                break;
+            }
+            if (is_poisoned(guard))
+                break;
+        }
+        return timeout_result(std::move(guard), timed_out);
+    }
+
+    template<class Rep, class Period, class Fn>
+    LockResult<std::pair<guard_t, WaitTimeoutResult>> wait_timeout_until(guard_t&& guard, Key const& key,
+        std::chrono::duration<Rep, Period> const dur, Fn&& condition) {
+        return wait_deadline_until(std::move(guard), key, sys::deadline_after(dur), std::forward<Fn>(condition));
+    }
+
+    // Panics unless `guard` is a guard of this monitor's mutex.
+    // Wakes every thread waiting on `key` and returns how many there were.
+    std::size_t notify(guard_t const& guard, Key const& key) {
+        verify(guard);
+        return waiters_.notify(key);
+    }
+
+    // Wakes the longest waiting thread on `key`.
+    bool notify_one(guard_t const& guard, Key const& key) {
+        verify(guard);
+        return waiters_.notify(key, 1) != 0;
+    }
+
+    std::size_t notify_all(guard_t const& guard) {
+        verify(guard);
+        return waiters_.notify_all();
+    }
+};
+
+} // namespace sync
+} // namespace rust
@@ -0,0 +1,526 @@
+// mpsc.hpp
+
+#pragma once
+
+#include "../_detail.hpp"
+#include "../option.hpp"
+#include "../result.hpp"
+#include "../sys/spin.hpp"
+#include "../sys_common/time.hpp"
+#include "cancel.hpp"
+#include "mpsc/array.hpp"
+#include "mpsc/counter.hpp"
+#include "mpsc/list.hpp"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <tuple>
+#include <utility>
+#include <variant>
+
+namespace rust {
+namespace sync {
+namespace mpsc {
+
+// ------------------------------------------------------------------------------------------
+// errors
+
+// The receiver is gone. Holds the message that could not be sent.
+template<class T>
+class SendError {
+    T value_;
+public:
+    template<class... Args, rust::detail::enable_variadic_ctr<SendError<T>, Args...> = 0>
+    constexpr explicit SendError(Args&&... args) : value_(std::forward<Args>(args)...) {}
+
+    [[nodiscard]] constexpr T& get_mut() noexcept { return value_; }
+    [[nodiscard]] constexpr T const& get_ref() const noexcept { return value_; }
+    [[nodiscard]] constexpr T&& into_inner() && { return std::move(value_); }
+};
+
+struct full_tag_t{ constexpr full_tag_t() noexcept = default; };
+static constexpr full_tag_t full_tag{};
+
+struct disconnected_tag_t{ constexpr disconnected_tag_t() noexcept = default; };
+static constexpr disconnected_tag_t disconnected_tag{};
+
+// The channel is full or the receiver is gone. Holds the message that could not be sent.
+template<class T>
+class TrySendError {
+    T value_;
+    bool disconnected_;
+public:
+    template<class... Args>
+    constexpr TrySendError(full_tag_t, Args&&... args) : value_(std::forward<Args>(args)...), disconnected_{false} {}
+    template<class... Args>
+    constexpr TrySendError(disconnected_tag_t, Args&&... args) : value_(std::forward<Args>(args)...), disconnected_{true} {}
+
+    [[nodiscard]] constexpr bool is_full() const noexcept { return !disconnected_; }
+    [[nodiscard]] constexpr bool is_disconnected() const noexcept { return disconnected_; }
+
+    [[nodiscard]] constexpr T& get_mut() noexcept { return value_; }
+    [[nodiscard]] constexpr T const& get_ref() const noexcept { return value_; }
+    [[nodiscard]] constexpr T&& into_inner() && { return std::move(value_); }
+};
+
+// All senders are gone and the channel is empty.
+struct RecvError { constexpr RecvError() noexcept = default; };
+
+enum class TryRecvError { Empty, Disconnected };
+
+// Canceled only when receiving with a CancellationToken.
+enum class RecvTimeoutError { Timeout, Disconnected, Canceled };
+
+// ------------------------------------------------------------------------------------------
+// blocking
+
+namespace detail {
+
+using Spin = sys::spin::Yield<64, 16>;
+
+// Claims a slot to receive from, spinning before it parks. Returns false if `deadline` passed
+// first, or once `abort()` holds, which is checked before every sleep.
+template<class C, class Abort>
+bool start_recv_until(C& chan, typename C::Token& token, std::chrono::steady_clock::time_point const deadline, Abort const& abort) {
+    for (;;) {
+        Spin spin{};
+        do {
+            if (chan.start_recv(token))
+                return true;
+        } while (spin.spin());
+        bool const woken = chan.receivers.wait_until([&] { return !chan.is_empty() || chan.is_disconnected() || abort(); }, deadline);
+        if (!woken || abort()) {
+            // a last look, ordered after leaving the sleepers: a rendezvous try_send that saw
+            // this thread still waiting counts on it to take the message
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            return chan.start_recv(token);
+        }
+    }
+}
+
+template<class C>
+bool start_send_until(C& chan, typename C::Token& token, std::chrono::steady_clock::time_point const deadline) {
+    for (;;) {
+        Spin spin{};
+        do {
+            if (chan.start_send(token))
+                return true;
+        } while (spin.spin());
+        if (!chan.senders.wait_until([&chan] { return !chan.is_full() || chan.is_disconnected(); }, deadline))
+            return chan.start_send(token);
+    }
+}
+
+template<class T, class C>
+result::Result<T, RecvTimeoutError> recv_until(C& chan, std::chrono::steady_clock::time_point const deadline) {
+    typename C::Token token;
+    if (!start_recv_until(chan, token, deadline, [] { return false; }))
+        return result::Err<T, RecvTimeoutError>(RecvTimeoutError::Timeout);
+    if (token.is_disconnected())
+        return result::Err<T, RecvTimeoutError>(RecvTimeoutError::Disconnected);
+    return result::Ok<T, RecvTimeoutError>(chan.read(token));
+}
+
+// Like `recv_until`, but gives up once `cancel` is canceled. The wake up notifies every receiver,
+// which is only the one.
+template<class T, class C>
+result::Result<T, RecvTimeoutError> recv_until(C& chan, std::chrono::steady_clock::time_point const deadline,
+                                               CancellationToken const& cancel) {
+    if (cancel.is_canceled()) RUST_ATTR_UNLIKELY
+        return result::Err<T, RecvTimeoutError>(RecvTimeoutError::Canceled);
+    typename C::Token token;
+    cancel::Waiter waiter(cancel, [&chan] { chan.receivers.notify_all(); });
+    bool armed = false;
+    // registers only once about to sleep, so receiving what is already there doesn't touch the token
+    auto const abort = [&] {
+        if (!armed && !waiter.arm())
+            return true;
+        armed = true;
+        return waiter.canceled();
+    };
+    if (!start_recv_until(chan, token, deadline, abort)) {
+        auto const err = waiter.canceled() ? RecvTimeoutError::Canceled : RecvTimeoutError::Timeout;
+        return result::Err<T, RecvTimeoutError>(err);
+    }
+    if (token.is_disconnected())
+        return result::Err<T, RecvTimeoutError>(RecvTimeoutError::Disconnected);
+    return result::Ok<T, RecvTimeoutError>(chan.read(token));
+}
+
+template<class T, class C>
+result::Result<T, TryRecvError> try_recv(C& chan) {
+    typename C::Token token;
+    if (!chan.start_recv(token))
+        return result::Err<T, TryRecvError>(TryRecvError::Empty);
+    if (token.is_disconnected())
+        return result::Err<T, TryRecvError>(TryRecvError::Disconnected);
+    return result::Ok<T, TryRecvError>(chan.read(token));
+}
+
+} // namespace detail
+
+// ------------------------------------------------------------------------------------------
+// channels
+
+template<class T> class Sender;
+template<class T> class SyncSender;
+template<class T> class Receiver;
+
+namespace detail {
+template<class... Ts> class Selector;
+} // namespace detail
+
+template<class T>
+[[nodiscard]] std::pair<Sender<T>, Receiver<T>> channel();
+
+template<class T>
+[[nodiscard]] std::pair<SyncSender<T>, Receiver<T>> sync_channel(std::size_t bound);
+
+// The sending half of an unbounded channel. Copies are additional senders.
+template<class T>
+class Sender {
+    using counter_t = detail::Counter<detail::ListChannel<T>>;
+    counter_t* counter_;
+
+    constexpr explicit Sender(counter_t* const counter) noexcept : counter_{counter} {}
+    friend std::pair<Sender<T>, Receiver<T>> channel<T>();
+
+public:
+    Sender(Sender const& other) noexcept : counter_{other.counter_} { counter_->acquire_sender(); }
+    Sender(Sender&& other) noexcept : counter_{std::exchange(other.counter_, nullptr)} {}
+
+    Sender& operator=(Sender other) noexcept {
+        std::swap(counter_, other.counter_);
+        return *this;
+    }
+
+    ~Sender() {
+        if (counter_)
+            counter_->release_sender();
+    }
+
+    [[nodiscard]] Sender clone() const noexcept { return *this; }
+
+    // Never blocks. Fails only once the receiver is gone, giving `msg` back.
+    result::Result<unit_t, SendError<T>> send(T msg) const {
+        auto& chan = counter_->chan;
+        typename detail::ListChannel<T>::Token token;
+        chan.start_send(token);
+        if (token.is_disconnected())
+            return result::Err<unit_t, SendError<T>>(std::move(msg));
+        chan.write(token, std::move(msg));
+        return result::Ok<unit_t, SendError<T>>();
+    }
+};
+
+// The sending half of a bounded channel. Copies are additional senders.
+template<class T>
+class SyncSender {
+    using counter_t = detail::Counter<detail::ArrayChannel<T>>;
+    counter_t* counter_;
+
+    constexpr explicit SyncSender(counter_t* const counter) noexcept : counter_{counter} {}
+    friend std::pair<SyncSender<T>, Receiver<T>> sync_channel<T>(std::size_t);
+
+public:
+    SyncSender(SyncSender const& other) noexcept : counter_{other.counter_} { counter_->acquire_sender(); }
+    SyncSender(SyncSender&& other) noexcept : counter_{std::exchange(other.counter_, nullptr)} {}
+
+    SyncSender& operator=(SyncSender other) noexcept {
+        std::swap(counter_, other.counter_);
+        return *this;
+    }
+
+    ~SyncSender() {
+        if (counter_)
+            counter_->release_sender();
+    }
+
+    [[nodiscard]] SyncSender clone() const noexcept { return *this; }
+
+    // Blocks while the channel is full. On a rendezvous channel, also until the message is received.
+    // Fails once the receiver is gone, giving `msg` back.
+    result::Result<unit_t, SendError<T>> send(T msg) const {
+        auto& chan = counter_->chan;
+        typename detail::ArrayChannel<T>::Token token;
+        detail::start_send_until(chan, token, std::chrono::steady_clock::time_point::max());
+        if (token.is_disconnected())
+            return result::Err<unit_t, SendError<T>>(std::move(msg));
+        chan.write(token, std::move(msg));
+        if (chan.is_rendezvous()) {
+            while (!chan.is_taken(token) && !chan.is_disconnected()) {
+                chan.senders.wait_until([&] { return chan.is_taken(token) || chan.is_disconnected(); },
+                                        std::chrono::steady_clock::time_point::max());
+            }
+            // the receiver left without it
+            if (chan.take_back(token, msg))
+                return result::Err<unit_t, SendError<T>>(std::move(msg));
+        }
+        return result::Ok<unit_t, SendError<T>>();
+    }
+
+    // Never blocks. Fails if the channel is full or the receiver is gone, giving `msg` back. A
+    // rendezvous channel counts as full unless the receiver is already waiting.
+    result::Result<unit_t, TrySendError<T>> try_send(T msg) const {
+        auto& chan = counter_->chan;
+        if (chan.is_rendezvous() && !chan.receivers.has_sleepers() && !chan.is_disconnected())
+            return result::Err<unit_t, TrySendError<T>>(full_tag, std::move(msg));
+        typename detail::ArrayChannel<T>::Token token;
+        if (!chan.start_send(token))
+            return result::Err<unit_t, TrySendError<T>>(full_tag, std::move(msg));
+        if (token.is_disconnected())
+            return result::Err<unit_t, TrySendError<T>>(disconnected_tag, std::move(msg));
+        chan.write(token, std::move(msg));
+        // the receiver may have given up since, after a last look that missed the message
+        if (chan.is_rendezvous() && !chan.receivers.has_sleepers() && chan.take_back(token, msg))
+            return result::Err<unit_t, TrySendError<T>>(full_tag, std::move(msg));
+        return result::Ok<unit_t, TrySendError<T>>();
+    }
+};
+
+// The receiving half of a channel. Only one thread may receive at a time.
+template<class T>
+class Receiver {
+    using list_t = detail::Counter<detail::ListChannel<T>>;
+    using array_t = detail::Counter<detail::ArrayChannel<T>>;
+
+    union {
+        list_t* list_;
+        array_t* array_;
+    };
+    bool bounded_;
+
+    constexpr explicit Receiver(list_t* const counter) noexcept : list_{counter}, bounded_{false} {}
+    constexpr explicit Receiver(array_t* const counter) noexcept : array_{counter}, bounded_{true} {}
+    friend std::pair<Sender<T>, Receiver<T>> channel<T>();
+    friend std::pair<SyncSender<T>, Receiver<T>> sync_channel<T>(std::size_t);
+    template<class... Ts> friend class detail::Selector;
+
+    template<class F>
+    decltype(auto) visit(F&& f) const {
+        if (bounded_)
+            return std::forward<F>(f)(array_->chan);
+        return std::forward<F>(f)(list_->chan);
+    }
+
+public:
+    Receiver(Receiver&& other) noexcept : list_{nullptr}, bounded_{other.bounded_} {
+        if (bounded_)
+            array_ = std::exchange(other.array_, nullptr);
+        else
+            list_ = std::exchange(other.list_, nullptr);
+    }
+
+    Receiver& operator=(Receiver&& other) noexcept {
+        Receiver tmp(std::move(other));
+        std::swap(bounded_, tmp.bounded_);
+        std::swap(list_, tmp.list_);
+        return *this;
+    }
+
+    Receiver(Receiver const&) = delete;
+    Receiver& operator=(Receiver const&) = delete;
+
+    ~Receiver() {
+        if (bounded_) {
+            if (array_)
+                array_->release_receiver();
+        }
+        else if (list_) {
+            list_->release_receiver();
+        }
+    }
+
+    // Never blocks.
+    result::Result<T, TryRecvError> try_recv() const {
+        return visit([](auto& chan) { return detail::try_recv<T>(chan); });
+    }
+
+    // Blocks until a message arrives. Fails once the channel is empty and all senders are gone.
+    result::Result<T, RecvError> recv() const {
+        auto res = visit([](auto& chan) { return detail::recv_until<T>(chan, std::chrono::steady_clock::time_point::max()); });
+        if (res.is_ok())
+            return result::Ok<T, RecvError>(std::move(res).unwrap_unsafe());
+        return result::Err<T, RecvError>();
+    }
+
+    template<class Rep, class Period>
+    result::Result<T, RecvTimeoutError> recv_timeout(std::chrono::duration<Rep, Period> const dur) const {
+        return recv_deadline(sys::deadline_after(dur));
+    }
+
+    result::Result<T, RecvTimeoutError> recv_deadline(std::chrono::steady_clock::time_point const deadline) const {
+        return visit([deadline](auto& chan) { return detail::recv_until<T>(chan, deadline); });
+    }
+
+    // Like `recv`, but gives up with Canceled once `token` is canceled.
+    result::Result<T, RecvTimeoutError> recv(CancellationToken const& token) const {
+        return recv_deadline(std::chrono::steady_clock::time_point::max(), token);
+    }
+
+    result::Result<T, RecvTimeoutError> recv_deadline(std::chrono::steady_clock::time_point const deadline,
+                                                      CancellationToken const& token) const {
+        return visit([&](auto& chan) { return detail::recv_until<T>(chan, deadline, token); });
+    }
+};
+
+// ------------------------------------------------------------------------------------------
+// select
+
+// The result of the receiver that fired, at the receiver's position in the `select` call.
+template<class... Ts>
+using Selected = std::variant<result::Result<Ts, RecvError>...>;
+
+namespace detail {
+
+// Waits on several receivers at once, parking on a single SelectContext all of their channels can wake.
+template<class... Ts>
+class Selector {
+    using selected_t = Selected<Ts...>;
+    using indices_t = std::index_sequence_for<Ts...>;
+    static constexpr std::size_t count = sizeof...(Ts);
+
+    std::tuple<Receiver<Ts> const&...> rxs_;
+
+    template<std::size_t I>
+    option::Option<selected_t> try_one() const {
+        using T = std::tuple_element_t<I, std::tuple<Ts...>>;
+        return std::get<I>(rxs_).visit([](auto& chan) -> option::Option<selected_t> {
+            typename std::decay_t<decltype(chan)>::Token token;
+            if (!chan.start_recv(token))
+                return option::None;
+            if (token.is_disconnected())
+                return option::Some<selected_t>(std::in_place_index<I>, result::Err<T, RecvError>());
+            return option::Some<selected_t>(std::in_place_index<I>, result::Ok<T, RecvError>(chan.read(token)));
+        });
+    }
+
+    template<std::size_t... Is>
+    option::Option<selected_t> try_at(std::size_t const i, std::index_sequence<Is...>) const {
+        option::Option<selected_t> selected = option::None;
+        (void)((i == Is && (selected = try_one<Is>(), true)) || ...);
+        return selected;
+    }
+
+    template<std::size_t... Is>
+    bool any_ready(std::index_sequence<Is...>) const {
+        return (std::get<Is>(rxs_).visit([](auto& chan) { return !chan.is_empty() || chan.is_disconnected(); }) || ...);
+    }
+
+    // The waker of each receiver's channel, null for a channel already listed earlier. A receiver
+    // passed twice must register once, as the waker holds a single registration.
+    template<std::size_t... Is>
+    std::array<Waker*, count> wakers(std::index_sequence<Is...>) const {
+        std::array<Waker*, count> wakers{std::get<Is>(rxs_).visit([](auto& chan) { return &chan.receivers; })...};
+        for (std::size_t i = 1; i < count; ++i) {
+            if (std::find(wakers.begin(), wakers.begin() + i, wakers[i]) != wakers.begin() + i)
+                wakers[i] = nullptr;
+        }
+        return wakers;
+    }
+
+    static void register_all(std::array<Waker*, count> const& wakers, SelectContext& ctx) noexcept {
+        for (auto* const waker : wakers) {
+            if (waker)
+                waker->register_select(&ctx);
+        }
+    }
+
+    // Returns how many channels took the registration to signal `ctx`.
+    static std::uint32_t withdraw_all(std::array<Waker*, count> const& wakers) noexcept {
+        std::uint32_t claimed = 0;
+        for (auto* const waker : wakers) {
+            if (waker && !waker->withdraw_select())
+                ++claimed;
+        }
+        return claimed;
+    }
+
+public:
+    explicit Selector(Receiver<Ts> const&... rxs) noexcept : rxs_{rxs...} {}
+
+    // Polls every receiver once, starting at a different one on each call so none starves the rest.
+    option::Option<selected_t> try_select() const {
+        thread_local std::size_t next = 0;
+        auto const start = next++;
+        option::Option<selected_t> selected = option::None;
+        for (std::size_t i = 0; i < count && selected.is_none(); ++i)
+            selected = try_at((start + i) % count, indices_t{});
+        return selected;
+    }
+
+    option::Option<selected_t> select_until(std::chrono::steady_clock::time_point const deadline) const {
+        for (;;) {
+            Spin spin{};
+            do {
+                auto selected = try_select();
+                if (selected.is_some())
+                    return selected;
+            } while (spin.spin());
+
+            auto const wakers = this->wakers(indices_t{});
+            SelectContext ctx;
+            register_all(wakers, ctx);
+            bool const woken = any_ready(indices_t{}) || ctx.wait_until(deadline);
+            // `ctx` lives on this stack, so every channel that took the registration must be done signalling
+            ctx.wait_signals(withdraw_all(wakers));
+            if (!woken) {
+                // see start_recv_until
+                std::atomic_thread_fence(std::memory_order_seq_cst);
+                return try_select();
+            }
+        }
+    }
+};
+
+} // namespace detail
+
+// Blocks until one of `rxs` has a message or is disconnected, and receives from it.
+// A disconnected receiver fires at once on every call, so it should be left out of later selects.
+template<class... Ts>
+Selected<Ts...> select(Receiver<Ts> const&... rxs) {
+    static_assert(sizeof...(Ts) > 0, "select needs at least one receiver");
+    return detail::Selector<Ts...>{rxs...}.select_until(std::chrono::steady_clock::time_point::max()).unwrap_unsafe();
+}
+
+// Never blocks. None if no receiver is ready.
+template<class... Ts>
+option::Option<Selected<Ts...>> try_select(Receiver<Ts> const&... rxs) {
+    static_assert(sizeof...(Ts) > 0, "try_select needs at least one receiver");
+    return detail::Selector<Ts...>{rxs...}.try_select();
+}
+
+// None if `deadline` passes before any receiver is ready.
+template<class... Ts>
+option::Option<Selected<Ts...>> select_deadline(std::chrono::steady_clock::time_point const deadline, Receiver<Ts> const&... rxs) {
+    static_assert(sizeof...(Ts) > 0, "select_deadline needs at least one receiver");
+    return detail::Selector<Ts...>{rxs...}.select_until(deadline);
+}
+
+template<class Rep, class Period, class... Ts>
+option::Option<Selected<Ts...>> select_timeout(std::chrono::duration<Rep, Period> const dur, Receiver<Ts> const&... rxs) {
+    return select_deadline(sys::deadline_after(dur), rxs...);
+}
+
+// An unbounded channel. Sending never blocks.
+template<class T>
+[[nodiscard]] std::pair<Sender<T>, Receiver<T>> channel() {
+    auto* const counter = new detail::Counter<detail::ListChannel<T>>();
+    return {Sender<T>{counter}, Receiver<T>{counter}};
+}
+
+// A channel holding up to `bound` messages, senders block while it is full.
+// With a bound of 0 every send waits until its message is received.
+template<class T>
+[[nodiscard]] std::pair<SyncSender<T>, Receiver<T>> sync_channel(std::size_t const bound) {
+    auto* const counter = new detail::Counter<detail::ArrayChannel<T>>(bound);
+    return {SyncSender<T>{counter}, Receiver<T>{counter}};
+}
+
+} // namespace mpsc
+} // namespace sync
+} // namespace rust
@@ -0,0 +1,250 @@
+// array.hpp
+
+#pragma once
+
+#include "../../_include.hpp"
+#include "../../sys/spin.hpp"
+#include "waker.hpp"
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <thread>
+#include <type_traits>
+#include <utility>
+
+namespace rust {
+namespace sync {
+namespace mpsc {
+namespace detail {
+
+// A bounded queue of messages in a ring buffer, for any number of senders and a single receiver.
+//
+// Every slot has a stamp telling whether it is ready for the next send or the next receive.
+// The head and tail indices hold the position in the buffer below `mark_bit`, the power of two
+// above the capacity, and count laps around it in units of `one_lap` above that. The tail's
+// mark bit is set on disconnection.
+template<class T>
+class ArrayChannel {
+    struct Slot {
+        std::atomic<std::size_t> stamp;
+        alignas(T) unsigned char storage[sizeof(T)];
+
+        T* msg() noexcept { return std::launder(reinterpret_cast<T*>(storage)); }
+    };
+
+    alignas(64) std::atomic<std::size_t> head_{0};
+    alignas(64) std::atomic<std::size_t> tail_{0};
+    alignas(64) std::size_t cap_;
+    std::size_t mark_bit_;
+    std::size_t one_lap_;
+    // senders wait for their message to be received, in a buffer of one
+    bool rendezvous_;
+    // Added to the head, the stamp of a rendezvous slot whose message is being received or taken
+    // back. The single slot's stamps are otherwise the head plus 0, 1 or a lap, so it matches none.
+    static constexpr std::size_t busy = 2;
+    std::unique_ptr<Slot[]> buffer_;
+
+    std::size_t next_index(std::size_t const index) const noexcept {
+        auto const i = index & (mark_bit_ - 1);
+        auto const lap = index & ~(one_lap_ - 1);
+        return i + 1 < cap_ ? index + 1 : lap + one_lap_;
+    }
+
+public:
+    Waker receivers;
+    Waker senders;
+
+    // a claimed slot, or a null slot if the channel is disconnected
+    struct Token {
+        Slot* slot = nullptr;
+        std::size_t stamp = 0;
+
+        [[nodiscard]] bool is_disconnected() const noexcept { return slot == nullptr; }
+    };
+
+    // a capacity of 0 makes a rendezvous channel
+    explicit ArrayChannel(std::size_t const capacity)
+        : cap_{capacity != 0 ? capacity : 1}
+        , mark_bit_{[this] {
+            std::size_t bit = 1;
+            while (bit < cap_ + 1)
+                bit <<= 1;
+            return bit;
+        }()}
+        , one_lap_{mark_bit_ << 1}
+        , rendezvous_{capacity == 0}
+        , buffer_{new Slot[cap_]}
+    {
+        // a slot is ready to be sent into when its stamp matches the tail
+        for (std::size_t i = 0; i < cap_; ++i)
+            buffer_[i].stamp.store(i, std::memory_order_relaxed);
+    }
+
+    ArrayChannel(ArrayChannel const&) = delete;
+    ArrayChannel& operator=(ArrayChannel const&) = delete;
+
+    ~ArrayChannel() {
+        auto const head = head_.load(std::memory_order_relaxed);
+        auto const tail = tail_.load(std::memory_order_relaxed) & ~mark_bit_;
+        auto const hix = head & (mark_bit_ - 1);
+        auto const tix = tail & (mark_bit_ - 1);
+        std::size_t len = 0;
+        if (hix < tix)
+            len = tix - hix;
+        else if (hix > tix)
+            len = cap_ - hix + tix;
+        else if (tail != head)
+            len = cap_;
+        for (std::size_t i = 0; i < len; ++i) {
+            auto const index = hix + i < cap_ ? hix + i : hix + i - cap_;
+            buffer_[index].msg()->~T();
+        }
+    }
+
+    [[nodiscard]] std::size_t capacity() const noexcept { return rendezvous_ ? 0 : cap_; }
+    [[nodiscard]] bool is_rendezvous() const noexcept { return rendezvous_; }
+
+    // Claims a slot to send into. Returns false if the channel is full,
+    // or true with a null slot if it is disconnected.
+    bool start_send(Token& token) noexcept {
+        auto tail = tail_.load(std::memory_order_relaxed);
+        for (;;) {
+            if (tail & mark_bit_) {
+                token.slot = nullptr;
+                return true;
+            }
+            auto& slot = buffer_[tail & (mark_bit_ - 1)];
+            auto const stamp = slot.stamp.load(std::memory_order_acquire);
+            if (tail == stamp) {
+                if (tail_.compare_exchange_weak(tail, next_index(tail), std::memory_order_seq_cst, std::memory_order_relaxed)) {
+                    token.slot = &slot;
+                    token.stamp = tail + 1;
+                    return true;
+                }
+                sys::spin_loop_hint();
+            }
+            else if (stamp + one_lap_ == tail + 1) {
+                // the slot still holds last lap's message: full unless the head moved on meanwhile
+                std::atomic_thread_fence(std::memory_order_seq_cst);
+                if (head_.load(std::memory_order_relaxed) + one_lap_ == tail)
+                    return false;
+                sys::spin_loop_hint();
+                tail = tail_.load(std::memory_order_relaxed);
+            }
+            else {
+                // a receiver is midway through the slot
+                std::this_thread::yield();
+                tail = tail_.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    void write(Token const& token, T&& msg) noexcept(std::is_nothrow_move_constructible_v<T>) {
+        ::new (static_cast<void*>(token.slot->storage)) T(std::move(msg));
+        token.slot->stamp.store(token.stamp, std::memory_order_seq_cst);
+        receivers.notify_one();
+    }
+
+    // Claims the next slot to receive from, only called by the receiver. Returns false if the
+    // channel is empty, or true with a null slot if it is also disconnected.
+    bool start_recv(Token& token) noexcept {
+        for (;;) {
+            // only a rendezvous sender taking its message back moves the head besides the receiver
+            auto const head = head_.load(std::memory_order_acquire);
+            auto& slot = buffer_[head & (mark_bit_ - 1)];
+            token.slot = &slot;
+            token.stamp = head + one_lap_;
+            auto stamp = slot.stamp.load(std::memory_order_acquire);
+            // a written slot needs no look at the tail
+            if (stamp == head + 1) RUST_ATTR_LIKELY {
+                // the sender of a rendezvous message may be taking it back, whoever marks the slot busy wins
+                if (!rendezvous_ || slot.stamp.compare_exchange_strong(stamp, head + busy, std::memory_order_acquire, std::memory_order_relaxed))
+                    return true;
+                continue;
+            }
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            auto const tail = tail_.load(std::memory_order_relaxed);
+            if ((tail & ~mark_bit_) == head) {
+                if (tail & mark_bit_) {
+                    token.slot = nullptr;
+                    return true;
+                }
+                return false;
+            }
+            // a sender claimed the slot and is writing it, or is taking a rendezvous message back
+            sys::snooze_until([&] {
+                return slot.stamp.load(std::memory_order_acquire) == head + 1 || head_.load(std::memory_order_relaxed) != head;
+            });
+        }
+    }
+
+    T read(Token const& token) noexcept(std::is_nothrow_move_constructible_v<T>) {
+        auto* const slot = token.slot;
+        T msg(std::move(*slot->msg()));
+        slot->msg()->~T();
+        auto const head = head_.load(std::memory_order_relaxed);
+        slot->stamp.store(token.stamp, std::memory_order_release);
+        // sequentially consistent, so a sender about to park on a full channel sees the room
+        head_.store(next_index(head), std::memory_order_seq_cst);
+        // a rendezvous sender waits for its message to be taken, next to senders waiting for room
+        if (rendezvous_)
+            senders.notify_all();
+        else
+            senders.notify_one();
+        return msg;
+    }
+
+    // Takes the message sent with `token` on a rendezvous channel back into `msg`, unless the
+    // receiver already claimed it. The slot is left as if the message had been received.
+    bool take_back(Token const& token, T& msg) noexcept(std::is_nothrow_move_assignable_v<T>) {
+        auto const head = token.stamp - 1;
+        auto expected = token.stamp;
+        if (!token.slot->stamp.compare_exchange_strong(expected, head + busy, std::memory_order_acquire, std::memory_order_relaxed))
+            return false;
+        msg = std::move(*token.slot->msg());
+        token.slot->msg()->~T();
+        token.slot->stamp.store(head + one_lap_, std::memory_order_release);
+        head_.store(next_index(head), std::memory_order_seq_cst);
+        senders.notify_all();
+        return true;
+    }
+
+    // Whether the message sent with `token` was received.
+    [[nodiscard]] bool is_taken(Token const& token) const noexcept {
+        return token.slot->stamp.load(std::memory_order_seq_cst) != token.stamp;
+    }
+
+    [[nodiscard]] bool is_empty() const noexcept {
+        auto const head = head_.load(std::memory_order_seq_cst);
+        auto const tail = tail_.load(std::memory_order_seq_cst);
+        return (tail & ~mark_bit_) == head;
+    }
+
+    [[nodiscard]] bool is_full() const noexcept {
+        auto const tail = tail_.load(std::memory_order_seq_cst);
+        auto const head = head_.load(std::memory_order_seq_cst);
+        return head + one_lap_ == (tail & ~mark_bit_);
+    }
+
+    [[nodiscard]] bool is_disconnected() const noexcept {
+        return tail_.load(std::memory_order_seq_cst) & mark_bit_;
+    }
+
+    void disconnect_senders() noexcept {
+        if (!(tail_.fetch_or(mark_bit_, std::memory_order_seq_cst) & mark_bit_))
+            receivers.notify_all();
+    }
+
+    // wakes senders blocked on a full channel, queued messages stay until the channel is destroyed
+    void disconnect_receivers() noexcept {
+        if (!(tail_.fetch_or(mark_bit_, std::memory_order_seq_cst) & mark_bit_))
+            senders.notify_all();
+    }
+};
+
+} // namespace detail
+} // namespace mpsc
+} // namespace sync
+} // namespace rust
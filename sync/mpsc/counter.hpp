@@ -0,0 +1,50 @@
+// counter.hpp
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <utility>
+
+namespace rust {
+namespace sync {
+namespace mpsc {
+namespace detail {
+
+// A channel shared by its senders and receivers. Whichever side lets go of it last deletes it.
+template<class C>
+class Counter {
+    std::atomic<std::size_t> senders_{1};
+    std::atomic<std::size_t> receivers_{1};
+    std::atomic<bool> destroy_{false};
+
+public:
+    C chan;
+
+    template<class... Args>
+    explicit Counter(Args&&... args) : chan(std::forward<Args>(args)...) {}
+
+    void acquire_sender() noexcept { senders_.fetch_add(1, std::memory_order_relaxed); }
+
+    // the last sender disconnects the channel
+    void release_sender() noexcept {
+        if (senders_.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            chan.disconnect_senders();
+            if (destroy_.exchange(true, std::memory_order_acq_rel))
+                delete this;
+        }
+    }
+
+    void release_receiver() noexcept {
+        if (receivers_.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            chan.disconnect_receivers();
+            if (destroy_.exchange(true, std::memory_order_acq_rel))
+                delete this;
+        }
+    }
+};
+
+} // namespace detail
+} // namespace mpsc
+} // namespace sync
+} // namespace rust
@@ -0,0 +1,232 @@
+// list.hpp
+
+#pragma once
+
+#include "../../_include.hpp"
+#include "../../sys/spin.hpp"
+#include "waker.hpp"
+
+#include <atomic>
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace rust {
+namespace sync {
+namespace mpsc {
+namespace detail {
+
+// An unbounded queue of messages in a linked list of blocks, for any number of senders and
+// a single receiver. Senders claim a slot with one CAS on the tail index and never wait for
+// each other. The receiver owns the head: receiving a message takes no read-modify-write.
+//
+// An index holds the position in its low bits shifted by `shift`. Positions run through laps of
+// `lap` slots, one per block, the last of which is never used: a sender finding the tail there
+// waits for the sender installing the next block. The tail's mark bit is set on disconnection.
+template<class T>
+class ListChannel {
+    static constexpr std::size_t lap = 32;
+    static constexpr std::size_t block_cap = lap - 1;
+    static constexpr std::size_t shift = 1;
+    static constexpr std::size_t mark_bit = 1;
+    static constexpr std::size_t step = std::size_t{1} << shift;
+
+    struct Slot {
+        alignas(T) unsigned char storage[sizeof(T)];
+        std::atomic<bool> written{false};
+
+        T* msg() noexcept { return std::launder(reinterpret_cast<T*>(storage)); }
+
+        void wait_write() const noexcept {
+            sys::snooze_until([this] { return written.load(std::memory_order_acquire); });
+        }
+    };
+
+    struct Block {
+        std::atomic<Block*> next{nullptr};
+        Slot slots[block_cap];
+
+        Block* wait_next() const noexcept {
+            Block* next_block = nullptr;
+            sys::snooze_until([&] { return (next_block = next.load(std::memory_order_acquire)) != nullptr; });
+            return next_block;
+        }
+    };
+
+    struct alignas(64) Position {
+        std::atomic<std::size_t> index{0};
+        std::atomic<Block*> block{nullptr};
+    };
+
+    Position head_;
+    Position tail_;
+
+public:
+    Waker receivers;
+
+    // a claimed slot, or a null block if the channel is disconnected
+    struct Token {
+        Block* block = nullptr;
+        std::size_t offset = 0;
+
+        [[nodiscard]] bool is_disconnected() const noexcept { return block == nullptr; }
+    };
+
+    ListChannel() noexcept = default;
+
+    ListChannel(ListChannel const&) = delete;
+    ListChannel& operator=(ListChannel const&) = delete;
+
+    ~ListChannel() {
+        auto head = head_.index.load(std::memory_order_relaxed);
+        auto const tail = tail_.index.load(std::memory_order_relaxed) & ~mark_bit;
+        auto* block = head_.block.load(std::memory_order_relaxed);
+        while (head != tail) {
+            auto const offset = (head >> shift) % lap;
+            if (offset < block_cap) {
+                block->slots[offset].msg()->~T();
+            }
+            else {
+                auto* const next = block->next.load(std::memory_order_relaxed);
+                delete block;
+                block = next;
+            }
+            head += step;
+        }
+        delete block;
+    }
+
+    // Claims a slot to send into. Only fails with a disconnected token.
+    void start_send(Token& token) {
+        auto tail = tail_.index.load(std::memory_order_acquire);
+        auto* block = tail_.block.load(std::memory_order_acquire);
+        Block* next_block = nullptr;
+        for (;;) {
+            if (tail & mark_bit) {
+                token.block = nullptr;
+                break;
+            }
+            auto const offset = (tail >> shift) % lap;
+            // the block is full and the next one is on its way
+            if (offset == block_cap) {
+                sys::snooze_until([&] { return ((tail = tail_.index.load(std::memory_order_acquire)) >> shift) % lap != block_cap; });
+                block = tail_.block.load(std::memory_order_acquire);
+                continue;
+            }
+            // allocate the next block up front, so the window in which others wait for it stays short
+            if (offset + 1 == block_cap && !next_block)
+                next_block = new Block{};
+            // the first message installs the first block
+            if (!block) {
+                auto* const first = new Block{};
+                if (tail_.block.compare_exchange_strong(block, first, std::memory_order_release, std::memory_order_relaxed)) {
+                    head_.block.store(first, std::memory_order_release);
+                    block = first;
+                }
+                else {
+                    delete first;
+                    tail = tail_.index.load(std::memory_order_acquire);
+                    block = tail_.block.load(std::memory_order_acquire);
+                    continue;
+                }
+            }
+            if (tail_.index.compare_exchange_weak(tail, tail + step, std::memory_order_seq_cst, std::memory_order_acquire)) {
+                if (offset + 1 == block_cap) {
+                    tail_.block.store(next_block, std::memory_order_release);
+                    // skip past the unused last position, keeping a mark a disconnect may have set meanwhile
+                    tail_.index.fetch_add(step, std::memory_order_release);
+                    block->next.store(next_block, std::memory_order_release);
+                    next_block = nullptr;
+                }
+                token.block = block;
+                token.offset = offset;
+                break;
+            }
+            block = tail_.block.load(std::memory_order_acquire);
+            sys::spin_loop_hint();
+        }
+        delete next_block;
+    }
+
+    void write(Token const& token, T&& msg) noexcept(std::is_nothrow_move_constructible_v<T>) {
+        auto& slot = token.block->slots[token.offset];
+        ::new (static_cast<void*>(slot.storage)) T(std::move(msg));
+        slot.written.store(true, std::memory_order_release);
+        receivers.notify_one();
+    }
+
+    // Claims the next slot to receive from, only called by the receiver. Returns false if the
+    // channel is empty, or true with a null block if it is also disconnected.
+    bool start_recv(Token& token) noexcept {
+        auto const head = head_.index.load(std::memory_order_relaxed);
+        auto const offset = (head >> shift) % lap;
+        auto* block = head_.block.load(std::memory_order_acquire);
+        // a written slot needs no look at the tail
+        if (block && block->slots[offset].written.load(std::memory_order_acquire)) RUST_ATTR_LIKELY {
+            token.block = block;
+            token.offset = offset;
+            return true;
+        }
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        auto const tail = tail_.index.load(std::memory_order_relaxed);
+        if ((head >> shift) == (tail >> shift)) {
+            if (tail & mark_bit) {
+                token.block = nullptr;
+                return true;
+            }
+            return false;
+        }
+        // a sender claimed the slot, but may still be installing the first block
+        if (!block)
+            sys::snooze_until([&] { return (block = head_.block.load(std::memory_order_acquire)) != nullptr; });
+        token.block = block;
+        token.offset = offset;
+        return true;
+    }
+
+    T read(Token const& token) noexcept(std::is_nothrow_move_constructible_v<T>) {
+        auto* const block = token.block;
+        auto& slot = block->slots[token.offset];
+        slot.wait_write();
+        T msg(std::move(*slot.msg()));
+        slot.msg()->~T();
+        auto head = head_.index.load(std::memory_order_relaxed) + step;
+        // senders are done with a block once all of its slots are written
+        if (token.offset + 1 == block_cap) {
+            head_.block.store(block->wait_next(), std::memory_order_release);
+            head += step;
+            delete block;
+        }
+        head_.index.store(head, std::memory_order_release);
+        return msg;
+    }
+
+    [[nodiscard]] bool is_empty() const noexcept {
+        auto const head = head_.index.load(std::memory_order_seq_cst);
+        auto const tail = tail_.index.load(std::memory_order_seq_cst);
+        return (head >> shift) == (tail >> shift);
+    }
+
+    [[nodiscard]] bool is_disconnected() const noexcept {
+        return tail_.index.load(std::memory_order_seq_cst) & mark_bit;
+    }
+
+    // unbounded: senders never wait
+    [[nodiscard]] constexpr bool is_full() const noexcept { return false; }
+
+    void disconnect_senders() noexcept {
+        if (!(tail_.index.fetch_or(mark_bit, std::memory_order_seq_cst) & mark_bit))
+            receivers.notify_all();
+    }
+
+    // queued messages stay until the channel is destroyed, which the last sender does
+    void disconnect_receivers() noexcept {
+        tail_.index.fetch_or(mark_bit, std::memory_order_seq_cst);
+    }
+};
+
+} // namespace detail
+} // namespace mpsc
+} // namespace sync
+} // namespace rust
@@ -0,0 +1,125 @@
+// waker.hpp
+
+#pragma once
+
+#include "../../_include.hpp"
+#include "../../sys/futex.hpp"
+#include "../../sys/spin.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+namespace rust {
+namespace sync {
+namespace mpsc {
+namespace detail {
+
+// A thread blocked in `select`, woken through whichever channel it registered with changes first.
+class SelectContext {
+    std::atomic<std::uint32_t> signals_{0};
+
+public:
+    constexpr SelectContext() noexcept = default;
+
+    SelectContext(SelectContext const&) = delete;
+    SelectContext& operator=(SelectContext const&) = delete;
+
+    // The context may be gone as soon as the increment lands, the wake after it at worst wakes
+    // some other waiter reusing the address spuriously.
+    void signal() noexcept {
+        signals_.fetch_add(1, std::memory_order_release);
+        sys::impl::futex_wake(signals_);
+    }
+
+    // Returns false if `deadline` passed before any signal.
+    bool wait_until(std::chrono::steady_clock::time_point const deadline) noexcept {
+        return sys::impl::futex_wait_until(signals_, 0, deadline);
+    }
+
+    // Waits out the signals of the `claimed` wakers that took the registration before it was withdrawn.
+    void wait_signals(std::uint32_t const claimed) const noexcept {
+        sys::snooze_until([&] { return signals_.load(std::memory_order_acquire) >= claimed; });
+    }
+};
+
+// Parks threads waiting for a channel to change. Notifying is a single load while nobody sleeps.
+// The channel state checked by `ready` and the state change preceding a notify must both use
+// sequentially consistent operations, so a sleeper either sees the change or gets woken.
+class Waker {
+    std::atomic<std::uint32_t> seq_{0};
+    std::atomic<std::uint32_t> sleepers_{0};
+    // at most one selecting thread, the single receiver
+    std::atomic<SelectContext*> select_{nullptr};
+
+    void bump() noexcept { seq_.fetch_add(1, std::memory_order_relaxed); }
+
+    // Whoever takes the registration out signals the selecting thread.
+    bool wake_select() noexcept {
+        if (!select_.load(std::memory_order_relaxed))
+            return false;
+        auto* const ctx = select_.exchange(nullptr, std::memory_order_acq_rel);
+        if (!ctx)
+            return false;
+        ctx->signal();
+        return true;
+    }
+
+public:
+    constexpr Waker() noexcept = default;
+
+    Waker(Waker const&) = delete;
+    Waker& operator=(Waker const&) = delete;
+
+    // Sleeps unless `ready()`. Returns false if `deadline` passed first.
+    template<class Ready>
+    bool wait_until(Ready&& ready, std::chrono::steady_clock::time_point const deadline) noexcept {
+        auto const seq = seq_.load(std::memory_order_relaxed);
+        sleepers_.fetch_add(1, std::memory_order_seq_cst);
+        bool woken = true;
+        if (!ready())
+            woken = sys::impl::futex_wait_until(seq_, seq, deadline);
+        // sequentially consistent for `has_sleepers`
+        sleepers_.fetch_sub(1, std::memory_order_seq_cst);
+        return woken;
+    }
+
+    // Counts as a sleeper until withdrawn, the caller checks its channels after registering.
+    void register_select(SelectContext* const ctx) noexcept {
+        select_.store(ctx, std::memory_order_release);
+        sleepers_.fetch_add(1, std::memory_order_seq_cst);
+    }
+
+    // Returns false if a notifier already took the registration and is about to signal.
+    bool withdraw_select() noexcept {
+        sleepers_.fetch_sub(1, std::memory_order_seq_cst);
+        return select_.exchange(nullptr, std::memory_order_acq_rel) != nullptr;
+    }
+
+    // Whether a thread is asleep here or about to be, including a registered select. A thread
+    // that stopped counting and then checks its channel behind a sequentially consistent fence
+    // sees any change made before a load of this that found it gone.
+    [[nodiscard]] bool has_sleepers() const noexcept { return sleepers_.load(std::memory_order_seq_cst) != 0; }
+
+    void notify_one() noexcept {
+        if (sleepers_.load(std::memory_order_seq_cst) != 0) RUST_ATTR_UNLIKELY {
+            if (wake_select())
+                return;
+            bump();
+            sys::impl::futex_wake(seq_);
+        }
+    }
+
+    void notify_all() noexcept {
+        if (sleepers_.load(std::memory_order_seq_cst) != 0) {
+            wake_select();
+            bump();
+            sys::impl::futex_wake_all(seq_);
+        }
+    }
+};
+
+} // namespace detail
+} // namespace mpsc
+} // namespace sync
+} // namespace rust
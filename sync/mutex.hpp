@@ -2,77 +2,127 @@
 
 #pragma once
 
+#include "../_include.hpp"
 #include "../sys_common/mutex.hpp"
+#include "../sys_common/time.hpp"
+#include "../thread/thread.hpp"
 #include "_sync_base.hpp"
 #ifdef RUST_DEBUG
     #include "../panic.hpp"
 #endif
 
+#include <chrono>
+#include <cstdint>
+#include <type_traits>
+
 namespace rust {
 namespace sync {
 
-template<class T>
+// Compile-time configuration of a Mutex.
+//   RawMutex: the lock implementation. sys::Mutex is the platform default; sys::RawMutex<Spin, Fair>
+//             selects a sys::spin strategy and whether contended unlocks hand the lock to a waiter.
+//   Poison:   whether a panic while holding the lock poisons it. When off, no poison state is read
+//             or written and lock() always returns Ok.
+template<class RawMutex = sys::Mutex, bool Poison = true>
+struct MutexPolicy {
+    using raw_mutex = RawMutex;
+    static constexpr bool poison = Poison;
+};
+
+template<class Spin = sys::spin::Default, bool Poison = true>
+using FairMutexPolicy = MutexPolicy<sys::RawMutex<Spin, true>, Poison>;
+
+template<bool Poison = true>
+using SpinMutexPolicy = MutexPolicy<sys::RawMutex<sys::spin::Yield<1000>, false>, Poison>;
+
+using NoPoisonMutexPolicy = MutexPolicy<sys::Mutex, false>;
+
+template<class T, class Policy = MutexPolicy<>>
 class Mutex;
 
-template<class T>
+template<class T, class Policy = MutexPolicy<>>
 class MutexGuard;
 
 namespace mutex {
-template<class T>
-constexpr sys::Mutex& guard_lock(MutexGuard<T>& guard) noexcept {
-    return guard.mtx_->mutex_;
-} 
+template<class T, class Policy>
+constexpr typename Policy::raw_mutex& guard_lock(MutexGuard<T, Policy>& guard) noexcept;
+template<class T, class Policy>
+constexpr Mutex<T, Policy> const& guard_mutex(MutexGuard<T, Policy> const& guard) noexcept;
 
-template<class T>
-constexpr Flag const& guard_poison(MutexGuard<T> const& guard) noexcept {
-    return guard.mtx_->poison_;
-}
+// Stands in for the poison Guard when the policy doesn't poison.
+struct NoPoison {
+    constexpr explicit NoPoison(bool) noexcept {}
+};
+
+// A base of MutexGuard, so without poisoning the guard is just its pointer.
+template<class Policy>
+using guard_poison_t = std::conditional_t<Policy::poison, Guard, NoPoison>;
 } // namespace mutex
 
-template<class T>
-class MutexGuard {
-    Mutex<T>* mtx_;
-    Guard const poison_;
+template<class T, class Policy>
+class MutexGuard : mutex::guard_poison_t<Policy> {
+    using poison_t = mutex::guard_poison_t<Policy>;
+
+    Mutex<T, Policy>* mtx_;
+
+    friend constexpr typename Policy::raw_mutex& mutex::guard_lock<T, Policy>(MutexGuard&) noexcept;
+    friend constexpr Mutex<T, Policy> const& mutex::guard_mutex<T, Policy>(MutexGuard const&) noexcept;
+
+    void unlock() noexcept {
+        // poison the lock if this thread started panicking while holding it
+        if constexpr (Policy::poison) {
+            if (!static_cast<poison_t const&>(*this).panicking && thread::panicking()) RUST_ATTR_UNLIKELY
+                mtx_->mutex_.poison();
+        }
+        mtx_->mutex_.raw_unlock();
+    }
+
+    static bool panicking() noexcept {
+        if constexpr (Policy::poison)
+            return thread::panicking();
+        else
+            return false;
+    }
 
-    friend constexpr sys::Mutex& mutex::guard_lock(MutexGuard&) noexcept;
-    friend constexpr Flag& mutex::guard_poison(MutexGuard&) noexcept;
 public:
-    constexpr explicit MutexGuard(Mutex<T>& mtx) noexcept
-        : mtx_{std::addressof(mtx)}
-        , poison_{[&mtx] {
-            auto res = mtx_.poison_.borrow();
-            return res.is_ok() ? res.unwrap_unsafe() 
-                               : res.unwrap_err_unsafe().get_ref();
-        }()}
+    constexpr explicit MutexGuard(Mutex<T, Policy>& mtx) noexcept
+        : poison_t{panicking()}
+        , mtx_{std::addressof(mtx)}
     {}
 
     constexpr MutexGuard(MutexGuard&& other) noexcept
-        : mtx_(std::exchange(other.mtx_, nullptr))
-        , poison(other.poison)
+        : poison_t(other)
+        , mtx_(std::exchange(other.mtx_, nullptr))
     {}
 
     constexpr MutexGuard& operator=(MutexGuard&& other) noexcept {
-        mtx_ = std::exchange(other.mtx_, nullptr);
-        poison_ = other.poison_;
+        if (this != std::addressof(other)) {
+            if (mtx_)
+                unlock();
+            mtx_ = std::exchange(other.mtx_, nullptr);
+            static_cast<poison_t&>(*this) = other;
+        }
+        return *this;
     }
 
     MutexGuard(MutexGuard const&) = delete;
     MutexGuard& operator=(MutexGuard const&) = delete;
 
     ~MutexGuard() {
-        if (mtx_) { 
-            mtx_->poison_.done(poison_);
-            mtx_->mutex_.raw_unlock(); 
-        }
+        if (mtx_)
+            unlock();
     }
 
     [[nodiscard]] constexpr T& operator*() noexcept { return mtx_->value_; }
     [[nodiscard]] constexpr T const& operator*() const noexcept { return mtx_->value_; }
 };
 
-template<class T> 
+template<class T, class Policy> 
 class Mutex {
+    using guard_t = MutexGuard<T, Policy>;
 public:
+    using policy_type = Policy;
+
     // constructors
     template<class... Args, rust::detail::enable_variadic_ctr<Mutex, Args...> = 0>
     constexpr explicit Mutex(Args&&... args)
@@ -84,8 +134,11 @@ public:
             other.mutex_.raw_lock();
             return std::move(other.value_);
         }())
-        , poison_{other.poison_.get()}
     {
+        if constexpr (Policy::poison) {
+            if (other.is_poisoned())
+                mutex_.poison();
+        }
         other.mutex_.raw_unlock();
     }
     
@@ -121,22 +174,42 @@ public:
     
     // is_poisoned
     [[nodiscard]] constexpr bool is_poisoned() const noexcept {
-        return poison_.get();
+        if constexpr (Policy::poison)
+            return mutex_.is_poisoned();
+        else
+            return false;
     }
 
     // lock
-    [[nodiscard]] constexpr LockResult<MutexGuard<T>> lock() noexcept {
+    [[nodiscard]] constexpr LockResult<guard_t> lock() noexcept {
         mutex_.raw_lock();
-        using ok_t = MutexGuard<T>;
-        using err_t = PoisonError<MutexGuard<T>>;
+        using ok_t = guard_t;
+        using err_t = PoisonError<guard_t>;
         return is_poisoned() ? result::Err<ok_t, err_t>(*this) 
                              : result::Ok<ok_t, err_t>(*this);
     }
 
+    // Like `lock`, but gives up once `token` is canceled. A token that is not canceled costs a
+    // relaxed load unless the lock has to be waited for.
+    [[nodiscard]] CancelLockResult<guard_t> lock(CancellationToken const& token) noexcept {
+        using ok_t = guard_t;
+        using err_t = CancelLockError<guard_t>;
+        if (token.is_canceled()) RUST_ATTR_UNLIKELY
+            return result::Err<ok_t, err_t>(Canceled);
+        if (!mutex_.try_lock()) {
+            cancel::Waiter waiter(token, [this] { mutex_.interrupt(); });
+            if (!waiter.arm() || !mutex_.try_lock_until(std::chrono::steady_clock::time_point::max(), [&] { return waiter.canceled(); }))
+                return result::Err<ok_t, err_t>(Canceled);
+        }
+        if (is_poisoned())
+            return result::Err<ok_t, err_t>(poison_tag, *this);
+        return result::Ok<ok_t, err_t>(*this);
+    }
+
     // try_lock
-    [[nodiscard]] constexpr TryLockResult<MutexGuard<T>> try_lock() noexcept {
-        using ok_t = MutexGuard<T>;
-        using err_t = TryLockError<MutexGuard<T>>;
+    [[nodiscard]] constexpr TryLockResult<guard_t> try_lock() noexcept {
+        using ok_t = guard_t;
+        using err_t = TryLockError<guard_t>;
         if (!mutex_.try_lock())
             return result::Err<ok_t, err_t>(WouldBlock);
         if (is_poisoned())
@@ -144,16 +217,51 @@ public:
         return result::Ok<ok_t, err_t>(*this);
     }
 
+    // try_lock_for
+    template<class Rep, class Period>
+    [[nodiscard]] TryLockResult<guard_t> try_lock_for(std::chrono::duration<Rep, Period> const dur) noexcept {
+        return try_lock_until(sys::deadline_after(dur));
+    }
+
+    // try_lock_until
+    [[nodiscard]] TryLockResult<guard_t> try_lock_until(std::chrono::steady_clock::time_point const deadline) noexcept {
+        using ok_t = guard_t;
+        using err_t = TryLockError<guard_t>;
+        if (!mutex_.try_lock_until(deadline))
+            return result::Err<ok_t, err_t>(WouldBlock);
+        if (is_poisoned())
+            return result::Err<ok_t, err_t>(poison_tag, *this);
+        return result::Ok<ok_t, err_t>(*this);
+    }
+
 private:
     T value_;
-    sys::Mutex mutex_{}; // make Box<sys::Mutex>?
-    Flag poison_{};
+    typename Policy::raw_mutex mutex_{}; // also holds the poison flag
 
-    friend class MutexGuard<T>;
+    friend class MutexGuard<T, Policy>;
+    friend constexpr typename Policy::raw_mutex& mutex::guard_lock<T, Policy>(MutexGuard<T, Policy>&) noexcept;
 };
 
+namespace mutex {
+template<class T, class Policy>
+constexpr typename Policy::raw_mutex& guard_lock(MutexGuard<T, Policy>& guard) noexcept {
+    return guard.mtx_->mutex_;
+} 
+
+// The mutex `guard` holds locked.
+template<class T, class Policy>
+constexpr Mutex<T, Policy> const& guard_mutex(MutexGuard<T, Policy> const& guard) noexcept {
+    return *guard.mtx_;
+}
+} // namespace mutex
+
 template<class T>
 Mutex(T) -> Mutex<T>;
 
+// the poison flag lives in the lock word: a Mutex costs 4 bytes plus padding over its value
+static_assert(sizeof(Mutex<std::uint64_t>) <= 16);
+// and without poisoning a guard is only its pointer
+static_assert(sizeof(MutexGuard<std::uint64_t, NoPoisonMutexPolicy>) == sizeof(void*));
+
 }
 }
\ No newline at end of file
@@ -0,0 +1,149 @@
+// once.hpp
+
+#pragma once
+
+#include "../_include.hpp"
+#include "../option.hpp"
+#include "../panic.hpp"
+#include "../result.hpp"
+#include "../sys_common/once.hpp"
+
+#include <functional>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace rust {
+namespace sync {
+
+class OnceState {
+    bool const poisoned_;
+public:
+    constexpr explicit OnceState(bool const poisoned) noexcept : poisoned_{poisoned} {}
+    // whether an earlier call panicked
+    [[nodiscard]] constexpr bool is_poisoned() const noexcept { return poisoned_; }
+};
+
+// Runs a one-time initialization. Once it completed, call_once is a single acquire load.
+// A panic in the function poisons the Once, after which call_once panics as well.
+class Once {
+    sys::Once once_{};
+public:
+    constexpr Once() noexcept = default;
+
+    Once(Once const&) = delete;
+    Once& operator=(Once const&) = delete;
+
+    [[nodiscard]] bool is_completed() const noexcept { return once_.is_completed(); }
+
+    template<class F>
+    void call_once(F&& f) {
+        if (once_.is_completed()) RUST_ATTR_LIKELY
+            return;
+        if (!once_.call(false, [&f](bool) { std::invoke(std::forward<F>(f)); }))
+            panic("Once instance has previously been poisoned");
+    }
+
+    // Like call_once, but also runs `f` on a poisoned Once, passing it a OnceState saying so.
+    template<class F>
+    void call_once_force(F&& f) {
+        if (once_.is_completed()) RUST_ATTR_LIKELY
+            return;
+        once_.call(true, [&f](bool const poisoned) { std::invoke(std::forward<F>(f), OnceState{poisoned}); });
+    }
+};
+
+// A value written once, by whichever thread gets to it first.
+// Reading an initialized cell is a single acquire load.
+template<class T>
+class OnceLock {
+    sys::Once once_{};
+    union {
+        char empty_;
+        T value_;
+    };
+
+public:
+    constexpr OnceLock() noexcept : empty_{} {}
+
+    OnceLock(OnceLock const&) = delete;
+    OnceLock& operator=(OnceLock const&) = delete;
+
+    ~OnceLock() {
+        if (once_.is_completed())
+            value_.~T();
+    }
+
+    [[nodiscard]] bool is_poisoned() const noexcept { return once_.is_poisoned(); }
+
+    // None while uninitialized or being initialized
+    [[nodiscard]] option::Option<T&> get() noexcept {
+        if (once_.is_completed())
+            return option::Some<T&>(value_);
+        return option::None;
+    }
+
+    [[nodiscard]] option::Option<T const&> get() const noexcept {
+        if (once_.is_completed())
+            return option::Some<T const&>(value_);
+        return option::None;
+    }
+
+    // Stores `value` unless the cell already holds one, in which case `value` is given back.
+    result::Result<unit_t, T> set(T value) {
+        bool stored = false;
+        get_or_init([&] {
+            stored = true;
+            return std::move(value);
+        });
+        if (stored)
+            return result::Ok<unit_t, T>();
+        return result::Err<unit_t, T>(std::move(value));
+    }
+
+    // Initializes the cell with `f()` if it is empty. Concurrent callers wait for the first to finish.
+    // Panics if an earlier initialization panicked.
+    template<class F>
+    T& get_or_init(F&& f) {
+        if (once_.is_completed()) RUST_ATTR_LIKELY
+            return value_;
+        if (!once_.call(false, [&](bool) { ::new (static_cast<void*>(std::addressof(value_))) T(std::invoke(std::forward<F>(f))); }))
+            panic("OnceLock instance has previously been poisoned");
+        return value_;
+    }
+
+    [[nodiscard]] option::Option<T> into_inner() && {
+        if (once_.is_completed())
+            return option::Some<T>(std::move(value_));
+        return option::None;
+    }
+};
+
+// A value initialized by `F` on first access.
+template<class T, class F = T(*)()>
+class Lazy {
+    OnceLock<T> cell_{};
+    F init_;
+
+public:
+    constexpr explicit Lazy(F f) : init_(std::move(f)) {}
+
+    Lazy(Lazy const&) = delete;
+    Lazy& operator=(Lazy const&) = delete;
+
+    // Panics if an earlier initialization panicked.
+    T& force() { return cell_.get_or_init([this] { return std::invoke(std::move(init_)); }); }
+
+    // None until initialized
+    [[nodiscard]] option::Option<T&> get() noexcept { return cell_.get(); }
+
+    T& operator*() { return force(); }
+    T* operator->() { return std::addressof(force()); }
+};
+
+template<class F>
+Lazy(F) -> Lazy<std::invoke_result_t<F&&>, F>;
+
+} // namespace sync
+} // namespace rust
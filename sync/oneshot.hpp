@@ -0,0 +1,275 @@
+// oneshot.hpp
+
+#pragma once
+
+#include "../_include.hpp"
+#include "../debug/debug.hpp"
+#include "../result.hpp"
+#include "../sys/futex.hpp"
+#include "../sys/spin.hpp"
+#include "../sys_common/time.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <new>
+#include <utility>
+
+namespace rust {
+namespace sync {
+namespace oneshot {
+
+// ------------------------------------------------------------------------------------------
+// errors
+
+// The sender was dropped without sending.
+struct Canceled { constexpr Canceled() noexcept = default; };
+
+enum class TryRecvError { Empty, Canceled };
+
+enum class RecvTimeoutError { Timeout, Canceled };
+
+// ------------------------------------------------------------------------------------------
+// inner
+
+namespace detail {
+
+using Spin = sys::spin::Yield<64, 16>;
+
+// The value and a single state word, which both halves also park on.
+// Whichever half finishes second deletes it.
+template<class T>
+class Inner {
+    static constexpr std::uint32_t value_set = 1; // the value was written
+    static constexpr std::uint32_t tx_done = 2;   // the sender is gone, having sent or not
+    static constexpr std::uint32_t rx_done = 4;   // the receiver is gone
+    static constexpr std::uint32_t rx_parked = 8; // the receiver may be asleep
+    static constexpr std::uint32_t tx_parked = 16; // the sender may be asleep
+
+    std::atomic<std::uint32_t> state_{0};
+    alignas(T) unsigned char storage_[sizeof(T)];
+
+    T* value() noexcept { return std::launder(reinterpret_cast<T*>(storage_)); }
+
+    // Waits until any of `bits` is set. Returns the state, or 0 if `deadline` passed first.
+    // A woken half wakes the other only after its final update, when the other may already
+    // have deleted the state: that wake at worst hits some other waiter reusing the address spuriously.
+    std::uint32_t wait_until(std::uint32_t const bits, std::uint32_t const parked,
+                             std::chrono::steady_clock::time_point const deadline) noexcept {
+        Spin spin{};
+        for (;;) {
+            auto state = state_.load(std::memory_order_acquire);
+            if (state & bits)
+                return state;
+            if (spin.spin())
+                continue;
+            state = state_.fetch_or(parked, std::memory_order_acquire) | parked;
+            if (state & bits)
+                return state;
+            if (!sys::impl::futex_wait_until(state_, state, deadline)) {
+                state = state_.load(std::memory_order_acquire);
+                return (state & bits) ? state : 0;
+            }
+        }
+    }
+
+    // Sets `bits` and wakes the other half if it may be asleep, whose parked bit is `parked`.
+    // Returns the previous state, which tells whether the other half is gone too.
+    std::uint32_t finish(std::uint32_t const bits, std::uint32_t const parked) noexcept {
+        auto const prev = state_.fetch_or(bits, std::memory_order_acq_rel);
+        if (prev & parked)
+            sys::impl::futex_wake_all(state_);
+        return prev;
+    }
+
+public:
+    Inner() noexcept = default;
+
+    Inner(Inner const&) = delete;
+    Inner& operator=(Inner const&) = delete;
+
+    // ---- sender
+
+    [[nodiscard]] bool is_closed() const noexcept { return state_.load(std::memory_order_acquire) & rx_done; }
+
+    // Gives `v` back if the receiver is gone. Ends the sender's use of the state.
+    result::Result<unit_t, T> send(T&& v) {
+        if (is_closed()) {
+            drop_sender();
+            return result::Err<unit_t, T>(std::move(v));
+        }
+        ::new (static_cast<void*>(storage_)) T(std::move(v));
+        auto const prev = finish(value_set | tx_done, rx_parked);
+        if (!(prev & rx_done))
+            return result::Ok<unit_t, T>();
+        // the receiver left meanwhile: take the value back and clean up
+        auto res = result::Err<unit_t, T>(std::move(*value()));
+        value()->~T();
+        delete this;
+        return res;
+    }
+
+    void drop_sender() noexcept {
+        if (finish(tx_done, rx_parked) & rx_done)
+            delete this;
+    }
+
+    // Blocks until the receiver is gone. Returns false if `deadline` passed first.
+    bool wait_closed_until(std::chrono::steady_clock::time_point const deadline) noexcept {
+        return wait_until(rx_done, tx_parked, deadline) != 0;
+    }
+
+    // ---- receiver
+
+    // Moves the value out into `out` if it was sent, or fails it with `canceled` if the sender is
+    // gone without sending. Returns false if neither happened yet. The moved-from value stays
+    // until the receiver is dropped.
+    template<class R, class E>
+    bool try_take(std::uint32_t const state, R& out, E const canceled) {
+        if (state & value_set) {
+            out = result::Ok<T, E>(std::move(*value()));
+            return true;
+        }
+        if (state & tx_done) {
+            out = result::Err<T, E>(canceled);
+            return true;
+        }
+        return false;
+    }
+
+    result::Result<T, TryRecvError> try_recv(bool& taken) {
+        auto res = result::Err<T, TryRecvError>(TryRecvError::Empty);
+        taken = try_take(state_.load(std::memory_order_acquire), res, TryRecvError::Canceled) && res.is_ok();
+        return res;
+    }
+
+    result::Result<T, RecvTimeoutError> recv_until(std::chrono::steady_clock::time_point const deadline, bool& taken) {
+        auto res = result::Err<T, RecvTimeoutError>(RecvTimeoutError::Timeout);
+        taken = try_take(wait_until(value_set | tx_done, rx_parked, deadline), res, RecvTimeoutError::Canceled) && res.is_ok();
+        return res;
+    }
+
+    void drop_receiver() noexcept {
+        auto const prev = finish(rx_done, tx_parked);
+        if (prev & value_set)
+            value()->~T();
+        if (prev & tx_done)
+            delete this;
+    }
+};
+
+} // namespace detail
+
+// ------------------------------------------------------------------------------------------
+// channel
+
+template<class T> class Sender;
+template<class T> class Receiver;
+
+template<class T>
+[[nodiscard]] std::pair<Sender<T>, Receiver<T>> channel();
+
+// Sends a single value. Dropping it unsent cancels the receiver.
+template<class T>
+class Sender {
+    detail::Inner<T>* inner_;
+
+    constexpr explicit Sender(detail::Inner<T>* const inner) noexcept : inner_{inner} {}
+    friend std::pair<Sender<T>, Receiver<T>> channel<T>();
+
+public:
+    Sender(Sender&& other) noexcept : inner_{std::exchange(other.inner_, nullptr)} {}
+
+    Sender& operator=(Sender&& other) noexcept {
+        Sender tmp(std::move(other));
+        std::swap(inner_, tmp.inner_);
+        return *this;
+    }
+
+    Sender(Sender const&) = delete;
+    Sender& operator=(Sender const&) = delete;
+
+    ~Sender() {
+        if (inner_)
+            inner_->drop_sender();
+    }
+
+    // Consumes the sender. Never blocks. Fails if the receiver is gone, giving `value` back.
+    result::Result<unit_t, T> send(T value) && {
+        return std::exchange(inner_, nullptr)->send(std::move(value));
+    }
+
+    // Whether the receiver is gone, in which case sending is pointless.
+    [[nodiscard]] bool is_closed() const noexcept { return inner_->is_closed(); }
+
+    // Blocks until the receiver is gone.
+    void closed() const noexcept { inner_->wait_closed_until(std::chrono::steady_clock::time_point::max()); }
+
+    // Returns false if `deadline` passed before the receiver was gone.
+    bool closed_deadline(std::chrono::steady_clock::time_point const deadline) const noexcept {
+        return inner_->wait_closed_until(deadline);
+    }
+};
+
+// Receives the single value. Used by one thread at a time.
+template<class T>
+class Receiver {
+    detail::Inner<T>* inner_;
+    bool taken_ = false;
+
+    constexpr explicit Receiver(detail::Inner<T>* const inner) noexcept : inner_{inner} {}
+    friend std::pair<Sender<T>, Receiver<T>> channel<T>();
+
+public:
+    Receiver(Receiver&& other) noexcept : inner_{std::exchange(other.inner_, nullptr)}, taken_{other.taken_} {}
+
+    Receiver& operator=(Receiver&& other) noexcept {
+        Receiver tmp(std::move(other));
+        std::swap(inner_, tmp.inner_);
+        std::swap(taken_, tmp.taken_);
+        return *this;
+    }
+
+    Receiver(Receiver const&) = delete;
+    Receiver& operator=(Receiver const&) = delete;
+
+    ~Receiver() {
+        if (inner_)
+            inner_->drop_receiver();
+    }
+
+    // Never blocks.
+    result::Result<T, TryRecvError> try_recv() {
+        debug_assert(!taken_, "oneshot::Receiver already received its value");
+        return inner_->try_recv(taken_);
+    }
+
+    // Blocks until the value is sent, or fails once the sender is dropped without sending.
+    result::Result<T, Canceled> recv() {
+        auto res = recv_deadline(std::chrono::steady_clock::time_point::max());
+        if (res.is_ok())
+            return result::Ok<T, Canceled>(std::move(res).unwrap_unsafe());
+        return result::Err<T, Canceled>();
+    }
+
+    template<class Rep, class Period>
+    result::Result<T, RecvTimeoutError> recv_timeout(std::chrono::duration<Rep, Period> const dur) {
+        return recv_deadline(sys::deadline_after(dur));
+    }
+
+    result::Result<T, RecvTimeoutError> recv_deadline(std::chrono::steady_clock::time_point const deadline) {
+        debug_assert(!taken_, "oneshot::Receiver already received its value");
+        return inner_->recv_until(deadline, taken_);
+    }
+};
+
+// A channel for a single value, in a single allocation.
+template<class T>
+[[nodiscard]] std::pair<Sender<T>, Receiver<T>> channel() {
+    auto* const inner = new detail::Inner<T>();
+    return {Sender<T>{inner}, Receiver<T>{inner}};
+}
+
+} // namespace oneshot
+} // namespace sync
+} // namespace rust
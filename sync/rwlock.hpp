@@ -2,10 +2,12 @@
 
 #pragma once
 
+#include <chrono>
 #include <utility>
 
 #include "../result.hpp"
 #include "../sys_common/rwlock.hpp"
+#include "../sys_common/time.hpp"
 #include "_sync_base.hpp"
 #ifdef RUST_DEBUG
     #include "../panic.hpp"
@@ -20,7 +22,7 @@ template<class T> class RwLockWriteGuard;
 template<class T> 
 class RwLock {
     T value_;
-    sys::RwLock rwlock_{};
+    sys::RWLock rwlock_{};
     Flag poison_{};
     friend class RwLockReadGuard<T>;
     friend class RwLockWriteGuard<T>;
@@ -62,17 +64,32 @@ public:
         return result::Ok<ok_t, err_t>(*this);
     }
 
-    [[nodiscard]] constexpr LockResult<RwLockReadGuard<T>> write() {
+    template<class Rep, class Period>
+    [[nodiscard]] TryLockResult<RwLockReadGuard<T>> try_read_for(std::chrono::duration<Rep, Period> const dur) {
+        return try_read_until(sys::deadline_after(dur));
+    }
+
+    [[nodiscard]] TryLockResult<RwLockReadGuard<T>> try_read_until(std::chrono::steady_clock::time_point const deadline) {
         using ok_t = RwLockReadGuard<T>;
-        using err_t = PoisonError<RwLockReadGuard<T>>;
+        using err_t = TryLockError<RwLockReadGuard<T>>;
+        if (!rwlock_.try_read_until(deadline))
+            return result::Err<ok_t, err_t>(WouldBlock);  
+        if (is_poisoned())
+            return result::Err<ok_t, err_t>(poison_tag, *this);
+        return result::Ok<ok_t, err_t>(*this);
+    }
+
+    [[nodiscard]] constexpr LockResult<RwLockWriteGuard<T>> write() {
+        using ok_t = RwLockWriteGuard<T>;
+        using err_t = PoisonError<RwLockWriteGuard<T>>;
         rwlock_.write();
         return is_poisoned() ? result::Err<ok_t, err_t>(*this)
                              : result::Ok<ok_t, err_t>(*this);
     }
 
-    [[nodiscard]] constexpr TryLockResult<RwLockReadGuard<T>> try_write() {
-        using ok_t = RwLockReadGuard<T>;
-        using err_t = TryLockError<RwLockReadGuard<T>>;
+    [[nodiscard]] constexpr TryLockResult<RwLockWriteGuard<T>> try_write() {
+        using ok_t = RwLockWriteGuard<T>;
+        using err_t = TryLockError<RwLockWriteGuard<T>>;
         if (!rwlock_.try_write())
             return result::Err<ok_t, err_t>(WouldBlock);  
         if (is_poisoned())
@@ -80,6 +97,21 @@ public:
         return result::Ok<ok_t, err_t>(*this);
     }
 
+    template<class Rep, class Period>
+    [[nodiscard]] TryLockResult<RwLockWriteGuard<T>> try_write_for(std::chrono::duration<Rep, Period> const dur) {
+        return try_write_until(sys::deadline_after(dur));
+    }
+
+    [[nodiscard]] TryLockResult<RwLockWriteGuard<T>> try_write_until(std::chrono::steady_clock::time_point const deadline) {
+        using ok_t = RwLockWriteGuard<T>;
+        using err_t = TryLockError<RwLockWriteGuard<T>>;
+        if (!rwlock_.try_write_until(deadline))
+            return result::Err<ok_t, err_t>(WouldBlock);  
+        if (is_poisoned())
+            return result::Err<ok_t, err_t>(poison_tag, *this);
+        return result::Ok<ok_t, err_t>(*this);
+    }
+
     [[nodiscard]] constexpr bool is_poisoned() const noexcept {
         return poison_.get();
     }
@@ -100,7 +132,7 @@ public:
 #ifdef RUST_DEBUG
         if (!rwlock_.try_write())
             panic("RwLock::get_mut called while RwLock was locked");
-        mutex_.write_unlock();
+        rwlock_.write_unlock();
 #endif // RUST_DEBUG
         using ok_t = T&;
         using err_t = PoisonError<T&>;
@@ -114,42 +146,58 @@ RwLock(T) -> RwLock<T>;
 
 template<class T>
 class RwLockReadGuard {
-    RwLock<T>& rwlock_;
+    RwLock<T>* rwlock_;
 public:
-    constexpr explicit RwLockReadGuard(RwLock<T>& rwlock) noexcept : rwlock_{rwlock} {}
+    constexpr explicit RwLockReadGuard(RwLock<T>& rwlock) noexcept : rwlock_{std::addressof(rwlock)} {}
+
+    constexpr RwLockReadGuard(RwLockReadGuard&& other) noexcept 
+        : rwlock_{std::exchange(other.rwlock_, nullptr)} 
+    {}
 
     RwLockReadGuard(RwLockReadGuard const&) = delete;
     RwLockReadGuard& operator=(RwLockReadGuard const&) = delete;
+    RwLockReadGuard& operator=(RwLockReadGuard&&) = delete;
 
-    ~RwLockReadGuard() { rwlock_.rwlock_.read_unlock(); }
+    ~RwLockReadGuard() { 
+        if (rwlock_)
+            rwlock_->rwlock_.read_unlock(); 
+    }
 
-    [[nodiscard]] constexpr T const& operator*() const { return rwlock_.value_; }
+    [[nodiscard]] constexpr T const& operator*() const { return rwlock_->value_; }
 };
 
 template<class T>
 class RwLockWriteGuard {
-    RwLock<T>& rwlock_;
+    RwLock<T>* rwlock_;
     Guard poison_;
 public:
     constexpr explicit RwLockWriteGuard(RwLock<T>& rwlock) noexcept 
-        : rwlock_{rwlock} 
+        : rwlock_{std::addressof(rwlock)} 
         , poison_{[&rwlock] {
-            auto res = rwlock_.poison_.borrow();
+            auto res = rwlock.poison_.borrow();
             return res.is_ok() ? res.unwrap_unsafe() 
                                : res.unwrap_err_unsafe().get_ref();
         }()}
     {}
 
+    constexpr RwLockWriteGuard(RwLockWriteGuard&& other) noexcept 
+        : rwlock_{std::exchange(other.rwlock_, nullptr)} 
+        , poison_{other.poison_}
+    {}
+
     RwLockWriteGuard(RwLockWriteGuard const&) = delete;
     RwLockWriteGuard& operator=(RwLockWriteGuard const&) = delete;
+    RwLockWriteGuard& operator=(RwLockWriteGuard&&) = delete;
 
-    ~RwLockreadGuard() {
-        rwlock_.poison_.done(poison_);
-        rwlock_.rwlock_.write_unlock();
+    ~RwLockWriteGuard() {
+        if (rwlock_) {
+            rwlock_->poison_.done(poison_);
+            rwlock_->rwlock_.write_unlock();
+        }
     }
 
-    [[nodiscard]] constexpr T& operator*() { return rwlock_.value_; }
-    [[nodiscard]] constexpr T const& operator*() const { return rwlock_.value_; }
+    [[nodiscard]] constexpr T& operator*() { return rwlock_->value_; }
+    [[nodiscard]] constexpr T const& operator*() const { return rwlock_->value_; }
 };
 
 } // namespace sync
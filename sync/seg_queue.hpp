@@ -0,0 +1,231 @@
+// seg_queue.hpp
+
+#pragma once
+
+#include "../option.hpp"
+#include "../sys/spin.hpp"
+
+#include <atomic>
+#include <cstddef>
+#include <new>
+#include <utility>
+
+namespace rust {
+namespace sync {
+
+// An unbounded multi-producer multi-consumer queue in a linked list of blocks.
+// Producers and consumers each claim a slot with one CAS on their end's index, and a block is
+// freed by whichever consumer finishes reading it last.
+//
+// An index holds the position in its low bits shifted by `shift`. Positions run through laps of
+// `lap` slots, one per block, the last of which is never used: a thread finding an index there
+// waits for the thread moving it on to the next block. The head's mark bit is set once the
+// head's block is known to have a successor, which saves consumers a look at the tail.
+template<class T>
+class SegQueue {
+    static constexpr std::size_t written = 1; // the value was written into the slot
+    static constexpr std::size_t taken = 2;   // the value was read out of the slot
+    static constexpr std::size_t destroy = 4; // the block is freed once this slot is read
+
+    static constexpr std::size_t lap = 32;
+    static constexpr std::size_t block_cap = lap - 1;
+    static constexpr std::size_t shift = 1;
+    static constexpr std::size_t has_next = 1;
+    static constexpr std::size_t step = std::size_t{1} << shift;
+
+    struct Slot {
+        alignas(T) unsigned char storage[sizeof(T)];
+        std::atomic<std::size_t> state{0};
+
+        T* value() noexcept { return std::launder(reinterpret_cast<T*>(storage)); }
+
+        void wait_write() const noexcept {
+            sys::snooze_until([this] { return state.load(std::memory_order_acquire) & written; });
+        }
+    };
+
+    struct Block {
+        std::atomic<Block*> next{nullptr};
+        Slot slots[block_cap];
+
+        Block* wait_next() const noexcept {
+            Block* next_block = nullptr;
+            sys::snooze_until([&] { return (next_block = next.load(std::memory_order_acquire)) != nullptr; });
+            return next_block;
+        }
+
+        // Frees the block once all slots from `start` on are read. A slot still being read
+        // gets marked instead, and its reader carries on from there.
+        static void destroy_from(Block* const block, std::size_t const start) noexcept {
+            // the last slot's reader is the one that starts destroying the block
+            for (auto i = start; i < block_cap - 1; ++i) {
+                auto& slot = block->slots[i];
+                if (!(slot.state.load(std::memory_order_acquire) & taken) &&
+                    !(slot.state.fetch_or(destroy, std::memory_order_acq_rel) & taken))
+                    return;
+            }
+            delete block;
+        }
+    };
+
+    struct alignas(64) Position {
+        std::atomic<std::size_t> index{0};
+        std::atomic<Block*> block{nullptr};
+    };
+
+    Position head_;
+    Position tail_;
+
+public:
+    SegQueue() noexcept = default;
+
+    SegQueue(SegQueue const&) = delete;
+    SegQueue& operator=(SegQueue const&) = delete;
+
+    ~SegQueue() {
+        auto head = head_.index.load(std::memory_order_relaxed) & ~has_next;
+        auto const tail = tail_.index.load(std::memory_order_relaxed) & ~has_next;
+        auto* block = head_.block.load(std::memory_order_relaxed);
+        while (head != tail) {
+            auto const offset = (head >> shift) % lap;
+            if (offset < block_cap) {
+                block->slots[offset].value()->~T();
+            }
+            else {
+                auto* const next = block->next.load(std::memory_order_relaxed);
+                delete block;
+                block = next;
+            }
+            head += step;
+        }
+        delete block;
+    }
+
+    void push(T value) {
+        auto tail = tail_.index.load(std::memory_order_acquire);
+        auto* block = tail_.block.load(std::memory_order_acquire);
+        Block* next_block = nullptr;
+        for (;;) {
+            auto const offset = (tail >> shift) % lap;
+            // the block is full and the next one is on its way
+            if (offset == block_cap) {
+                sys::snooze_until([&] { return ((tail = tail_.index.load(std::memory_order_acquire)) >> shift) % lap != block_cap; });
+                block = tail_.block.load(std::memory_order_acquire);
+                continue;
+            }
+            // allocate the next block up front, so the window in which others wait for it stays short
+            if (offset + 1 == block_cap && !next_block)
+                next_block = new Block{};
+            // the first push installs the first block
+            if (!block) {
+                auto* const first = new Block{};
+                if (tail_.block.compare_exchange_strong(block, first, std::memory_order_release, std::memory_order_relaxed)) {
+                    head_.block.store(first, std::memory_order_release);
+                    block = first;
+                }
+                else {
+                    delete first;
+                    tail = tail_.index.load(std::memory_order_acquire);
+                    block = tail_.block.load(std::memory_order_acquire);
+                    continue;
+                }
+            }
+            if (tail_.index.compare_exchange_weak(tail, tail + step, std::memory_order_seq_cst, std::memory_order_acquire)) {
+                if (offset + 1 == block_cap) {
+                    tail_.block.store(next_block, std::memory_order_release);
+                    tail_.index.store(tail + 2 * step, std::memory_order_release);
+                    block->next.store(next_block, std::memory_order_release);
+                    next_block = nullptr;
+                }
+                auto& slot = block->slots[offset];
+                ::new (static_cast<void*>(slot.storage)) T(std::move(value));
+                slot.state.fetch_or(written, std::memory_order_release);
+                break;
+            }
+            block = tail_.block.load(std::memory_order_acquire);
+            sys::spin_loop_hint();
+        }
+        delete next_block;
+    }
+
+    // None if the queue is empty.
+    [[nodiscard]] option::Option<T> pop() {
+        auto head = head_.index.load(std::memory_order_acquire);
+        auto* block = head_.block.load(std::memory_order_acquire);
+        for (;;) {
+            auto const offset = (head >> shift) % lap;
+            if (offset == block_cap) {
+                sys::snooze_until([&] { return ((head = head_.index.load(std::memory_order_acquire)) >> shift) % lap != block_cap; });
+                block = head_.block.load(std::memory_order_acquire);
+                continue;
+            }
+            auto new_head = head + step;
+            if (!(new_head & has_next)) {
+                std::atomic_thread_fence(std::memory_order_seq_cst);
+                auto const tail = tail_.index.load(std::memory_order_relaxed);
+                if ((head >> shift) == (tail >> shift))
+                    return option::None;
+                // the tail moved on to another block, so this one has a successor
+                if ((head >> shift) / lap != (tail >> shift) / lap)
+                    new_head |= has_next;
+            }
+            // the first push is still installing the first block
+            if (!block) {
+                sys::spin_loop_hint();
+                head = head_.index.load(std::memory_order_acquire);
+                block = head_.block.load(std::memory_order_acquire);
+                continue;
+            }
+            if (head_.index.compare_exchange_weak(head, new_head, std::memory_order_seq_cst, std::memory_order_acquire)) {
+                if (offset + 1 == block_cap) {
+                    auto* const next = block->wait_next();
+                    auto next_index = (new_head & ~has_next) + step;
+                    if (next->next.load(std::memory_order_relaxed))
+                        next_index |= has_next;
+                    head_.block.store(next, std::memory_order_release);
+                    head_.index.store(next_index, std::memory_order_release);
+                }
+                auto& slot = block->slots[offset];
+                slot.wait_write();
+                auto value = option::Some<T>(std::move(*slot.value()));
+                slot.value()->~T();
+                // whoever reads last frees the block
+                if (offset + 1 == block_cap)
+                    Block::destroy_from(block, 0);
+                else if (slot.state.fetch_or(taken, std::memory_order_acq_rel) & destroy)
+                    Block::destroy_from(block, offset + 1);
+                return value;
+            }
+            block = head_.block.load(std::memory_order_acquire);
+            sys::spin_loop_hint();
+        }
+    }
+
+    [[nodiscard]] bool is_empty() const noexcept {
+        auto const head = head_.index.load(std::memory_order_seq_cst);
+        auto const tail = tail_.index.load(std::memory_order_seq_cst);
+        return (head >> shift) == (tail >> shift);
+    }
+
+    // a consistent snapshot of the number of values
+    [[nodiscard]] std::size_t len() const noexcept {
+        for (;;) {
+            auto tail = tail_.index.load(std::memory_order_seq_cst);
+            auto head = head_.index.load(std::memory_order_seq_cst);
+            if (tail_.index.load(std::memory_order_seq_cst) != tail)
+                continue;
+            tail = (tail & ~has_next) >> shift;
+            head = (head & ~has_next) >> shift;
+            // skip the unused last position of every block
+            if ((tail % lap) == block_cap)
+                ++tail;
+            if ((head % lap) == block_cap)
+                ++head;
+            auto const head_lap = head / lap * lap;
+            return (tail - head_lap) - (tail - head_lap) / lap - (head - head_lap);
+        }
+    }
+};
+
+} // namespace sync
+} // namespace rust
@@ -0,0 +1,104 @@
+// semaphore.hpp
+
+#pragma once
+
+#include "../option.hpp"
+#include "../sys_common/semaphore.hpp"
+#include "../sys_common/time.hpp"
+
+#include <chrono>
+#include <cstdint>
+#include <utility>
+
+namespace rust {
+namespace sync {
+
+class Semaphore;
+
+// Permits taken from a Semaphore, given back when dropped.
+class SemaphorePermit {
+    Semaphore* sem_;
+    std::uint32_t permits_;
+
+    constexpr SemaphorePermit(Semaphore* const sem, std::uint32_t const permits) noexcept : sem_{sem}, permits_{permits} {}
+    friend class Semaphore;
+
+public:
+    SemaphorePermit(SemaphorePermit&& other) noexcept
+        : sem_{std::exchange(other.sem_, nullptr)}, permits_{std::exchange(other.permits_, 0)} {}
+
+    SemaphorePermit& operator=(SemaphorePermit&& other) noexcept {
+        SemaphorePermit tmp(std::move(other));
+        std::swap(sem_, tmp.sem_);
+        std::swap(permits_, tmp.permits_);
+        return *this;
+    }
+
+    SemaphorePermit(SemaphorePermit const&) = delete;
+    SemaphorePermit& operator=(SemaphorePermit const&) = delete;
+
+    inline ~SemaphorePermit();
+
+    [[nodiscard]] constexpr std::uint32_t num_permits() const noexcept { return permits_; }
+
+    // Keeps the permits out of the semaphore for good.
+    void forget() noexcept {
+        sem_ = nullptr;
+        permits_ = 0;
+    }
+};
+
+// Hands out a limited number of permits. Threads wanting more than are available block until
+// enough are given back.
+class Semaphore {
+    sys::Semaphore<> sem_;
+
+    friend class SemaphorePermit;
+
+public:
+    constexpr explicit Semaphore(std::uint32_t const permits) noexcept : sem_(permits) {}
+
+    Semaphore(Semaphore const&) = delete;
+    Semaphore& operator=(Semaphore const&) = delete;
+
+    [[nodiscard]] std::uint32_t available_permits() const noexcept { return sem_.available(); }
+
+    // Adds `n` new permits, waking threads waiting for them.
+    void add_permits(std::uint32_t const n) noexcept { sem_.release(n); }
+
+    [[nodiscard]] SemaphorePermit acquire() noexcept { return acquire_many(1); }
+
+    [[nodiscard]] SemaphorePermit acquire_many(std::uint32_t const n) noexcept {
+        sem_.acquire_until(n, std::chrono::steady_clock::time_point::max());
+        return SemaphorePermit{this, n};
+    }
+
+    // Never blocks.
+    [[nodiscard]] option::Option<SemaphorePermit> try_acquire() noexcept { return try_acquire_many(1); }
+
+    [[nodiscard]] option::Option<SemaphorePermit> try_acquire_many(std::uint32_t const n) noexcept {
+        if (!sem_.try_acquire(n))
+            return option::None;
+        return option::Some<SemaphorePermit>(SemaphorePermit{this, n});
+    }
+
+    template<class Rep, class Period>
+    [[nodiscard]] option::Option<SemaphorePermit> acquire_many_timeout(std::uint32_t const n, std::chrono::duration<Rep, Period> const dur) noexcept {
+        return acquire_many_deadline(n, sys::deadline_after(dur));
+    }
+
+    // None if `deadline` passed before `n` permits were available.
+    [[nodiscard]] option::Option<SemaphorePermit> acquire_many_deadline(std::uint32_t const n, std::chrono::steady_clock::time_point const deadline) noexcept {
+        if (!sem_.acquire_until(n, deadline))
+            return option::None;
+        return option::Some<SemaphorePermit>(SemaphorePermit{this, n});
+    }
+};
+
+inline SemaphorePermit::~SemaphorePermit() {
+    if (sem_ && permits_ != 0)
+        sem_->sem_.release(permits_);
+}
+
+} // namespace sync
+} // namespace rust
@@ -0,0 +1,171 @@
+// spsc.hpp
+
+#pragma once
+
+#include "../_include.hpp"
+#include "../option.hpp"
+#include "../result.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <utility>
+
+namespace rust {
+namespace sync {
+namespace spsc {
+
+// A run of contiguous, uninitialized slots handed out by RingBuffer::reserve.
+template<class T>
+struct Reservation {
+    T* data = nullptr;
+    std::size_t len = 0;
+
+    [[nodiscard]] constexpr T* begin() const noexcept { return data; }
+    [[nodiscard]] constexpr T* end() const noexcept { return data + len; }
+    [[nodiscard]] constexpr std::size_t size() const noexcept { return len; }
+    [[nodiscard]] constexpr bool empty() const noexcept { return len == 0; }
+};
+
+// A bounded queue between exactly one producer thread and one consumer thread.
+// push, push_slice, reserve and commit may only be called by the producer, pop and pop_slice
+// only by the consumer. No operation blocks or retries: each side reads the other's index only
+// when its cached copy says the buffer is full or empty, and publishes with one release store,
+// whether it moved one element or a whole batch.
+template<class T>
+class RingBuffer {
+    // indices run freely and are reduced modulo the power of two capacity when used
+    alignas(64) std::atomic<std::size_t> head_{0}; // written by the consumer
+    alignas(64) std::size_t cached_tail_ = 0;      // the consumer's copy of tail_
+    alignas(64) std::atomic<std::size_t> tail_{0}; // written by the producer
+    alignas(64) std::size_t cached_head_ = 0;      // the producer's copy of head_
+    alignas(64) std::size_t cap_;
+    std::size_t mask_;
+    T* buffer_;
+
+    static std::size_t round_up(std::size_t const n) noexcept {
+        std::size_t cap = 1;
+        while (cap < n)
+            cap <<= 1;
+        return cap;
+    }
+
+    // free slots from the producer's view, re-reading head_ only if fewer than `wanted`
+    std::size_t free_slots(std::size_t const tail, std::size_t const wanted) noexcept {
+        auto free = cap_ - (tail - cached_head_);
+        if (free < wanted) {
+            cached_head_ = head_.load(std::memory_order_acquire);
+            free = cap_ - (tail - cached_head_);
+        }
+        return free;
+    }
+
+    // filled slots from the consumer's view, re-reading tail_ only if fewer than `wanted`
+    std::size_t filled_slots(std::size_t const head, std::size_t const wanted) noexcept {
+        auto filled = cached_tail_ - head;
+        if (filled < wanted) {
+            cached_tail_ = tail_.load(std::memory_order_acquire);
+            filled = cached_tail_ - head;
+        }
+        return filled;
+    }
+
+public:
+    // `capacity` is rounded up to a power of two
+    explicit RingBuffer(std::size_t const capacity)
+        : cap_{round_up(capacity)}
+        , mask_{cap_ - 1}
+        , buffer_{std::allocator<T>{}.allocate(cap_)}
+    {}
+
+    RingBuffer(RingBuffer const&) = delete;
+    RingBuffer& operator=(RingBuffer const&) = delete;
+
+    ~RingBuffer() {
+        auto const tail = tail_.load(std::memory_order_relaxed);
+        for (auto i = head_.load(std::memory_order_relaxed); i != tail; ++i)
+            buffer_[i & mask_].~T();
+        std::allocator<T>{}.deallocate(buffer_, cap_);
+    }
+
+    [[nodiscard]] std::size_t capacity() const noexcept { return cap_; }
+
+    // exact when called by either side while the other is idle, a snapshot otherwise
+    [[nodiscard]] std::size_t size() const noexcept {
+        auto const head = head_.load(std::memory_order_acquire);
+        return tail_.load(std::memory_order_acquire) - head;
+    }
+
+    [[nodiscard]] bool empty() const noexcept { return size() == 0; }
+
+    // producer
+
+    // Gives `value` back if the buffer is full.
+    result::Result<unit_t, T> push(T value) {
+        auto const tail = tail_.load(std::memory_order_relaxed);
+        if (free_slots(tail, 1) == 0)
+            return result::Err<unit_t, T>(std::move(value));
+        ::new (static_cast<void*>(buffer_ + (tail & mask_))) T(std::move(value));
+        tail_.store(tail + 1, std::memory_order_release);
+        return result::Ok<unit_t, T>();
+    }
+
+    // Copies as many of the `n` elements at `src` as fit. Returns how many were pushed.
+    std::size_t push_slice(T const* const src, std::size_t const n) {
+        auto const tail = tail_.load(std::memory_order_relaxed);
+        auto const count = std::min(n, free_slots(tail, n));
+        auto const offset = tail & mask_;
+        auto const first = std::min(count, cap_ - offset);
+        std::uninitialized_copy_n(src, first, buffer_ + offset);
+        std::uninitialized_copy_n(src + first, count - first, buffer_);
+        tail_.store(tail + count, std::memory_order_release);
+        return count;
+    }
+
+    // Hands out up to `n` free slots that are contiguous in memory, fewer where the buffer wraps
+    // around or fills up. The caller constructs elements in them, then publishes them with commit.
+    [[nodiscard]] Reservation<T> reserve(std::size_t const n) noexcept {
+        auto const tail = tail_.load(std::memory_order_relaxed);
+        auto const offset = tail & mask_;
+        auto const len = std::min({n, free_slots(tail, n), cap_ - offset});
+        return Reservation<T>{buffer_ + offset, len};
+    }
+
+    // Publishes the first `n` slots of the last reservation, which must all have been constructed.
+    void commit(std::size_t const n) noexcept {
+        tail_.store(tail_.load(std::memory_order_relaxed) + n, std::memory_order_release);
+    }
+
+    // consumer
+
+    [[nodiscard]] option::Option<T> pop() {
+        auto const head = head_.load(std::memory_order_relaxed);
+        if (filled_slots(head, 1) == 0)
+            return option::None;
+        auto* const slot = buffer_ + (head & mask_);
+        auto value = option::Some<T>(std::move(*slot));
+        slot->~T();
+        head_.store(head + 1, std::memory_order_release);
+        return value;
+    }
+
+    // Moves up to `n` elements into the existing objects at `dst`. Returns how many were popped.
+    std::size_t pop_slice(T* const dst, std::size_t const n) {
+        auto const head = head_.load(std::memory_order_relaxed);
+        auto const count = std::min(n, filled_slots(head, n));
+        auto const offset = head & mask_;
+        auto const first = std::min(count, cap_ - offset);
+        std::move(buffer_ + offset, buffer_ + offset + first, dst);
+        std::destroy_n(buffer_ + offset, first);
+        std::move(buffer_, buffer_ + (count - first), dst + first);
+        std::destroy_n(buffer_, count - first);
+        head_.store(head + count, std::memory_order_release);
+        return count;
+    }
+};
+
+} // namespace spsc
+} // namespace sync
+} // namespace rust
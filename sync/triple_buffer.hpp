@@ -0,0 +1,71 @@
+// triple_buffer.hpp
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <type_traits>
+#include <utility>
+
+namespace rust {
+namespace sync {
+
+// The latest value passed from exactly one producer thread to one consumer thread.
+// Of the three buffers, the producer writes one, the consumer reads another, and the third holds
+// the value last published. Publishing swaps the written buffer with the middle one, reading
+// swaps the middle one in if it is newer: both sides are wait-free, and values the consumer
+// never got to are simply overwritten.
+// input_buffer, publish and write may only be called by the producer, the rest by the consumer.
+template<class T>
+class TripleBuffer {
+    static constexpr std::uint8_t dirty = 4; // the middle buffer holds a value not read yet
+
+    struct alignas(64) Buffer {
+        T value;
+    };
+
+    Buffer buffers_[3];
+    alignas(64) std::atomic<std::uint8_t> middle_{1}; // index of the middle buffer, plus the dirty bit
+    alignas(64) std::uint8_t input_ = 0;               // owned by the producer
+    alignas(64) std::uint8_t output_ = 2;              // owned by the consumer
+
+public:
+    TripleBuffer() = default;
+
+    explicit TripleBuffer(T const& init) : buffers_{{init}, {init}, {init}} {}
+
+    TripleBuffer(TripleBuffer const&) = delete;
+    TripleBuffer& operator=(TripleBuffer const&) = delete;
+
+    // The producer's buffer, to update in place before publishing. It holds whatever value it was
+    // last swapped out with, not necessarily the last one published.
+    [[nodiscard]] T& input_buffer() noexcept { return buffers_[input_].value; }
+
+    void publish() noexcept {
+        auto const old = middle_.exchange(input_ | dirty, std::memory_order_acq_rel);
+        input_ = old & ~dirty;
+    }
+
+    void write(T value) noexcept(std::is_nothrow_move_assignable_v<T>) {
+        input_buffer() = std::move(value);
+        publish();
+    }
+
+    // Whether a value was published since the last read.
+    [[nodiscard]] bool updated() const noexcept { return middle_.load(std::memory_order_relaxed) & dirty; }
+
+    // The latest published value, valid until the next read. Takes no copy.
+    [[nodiscard]] T const& read() noexcept {
+        if (updated()) {
+            auto const old = middle_.exchange(output_, std::memory_order_acq_rel);
+            output_ = old & ~dirty;
+        }
+        return buffers_[output_].value;
+    }
+
+    // The value returned by the last read, for the consumer to work on in place.
+    [[nodiscard]] T& output_buffer() noexcept { return buffers_[output_].value; }
+};
+
+} // namespace sync
+} // namespace rust
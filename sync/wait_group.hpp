@@ -0,0 +1,77 @@
+// wait_group.hpp
+
+#pragma once
+
+#include "../_include.hpp"
+#include "../sys/futex.hpp"
+#include "../sys/spin.hpp"
+#include "../sys_common/time.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+namespace rust {
+namespace sync {
+
+// Waits for a changing number of tasks to finish. Tasks are added and marked done in any order,
+// and waiting returns once the count has dropped to zero since the wait began, even if new
+// tasks were added right after. Reusable as often as the count reaches zero.
+class WaitGroup {
+    alignas(64) std::atomic<std::uint32_t> count_{0};
+    // bumped every time the count reaches zero, waiters sleep on it
+    alignas(64) std::atomic<std::uint32_t> generation_{0};
+    std::atomic<std::uint32_t> waiters_{0};
+
+public:
+    constexpr WaitGroup() noexcept = default;
+
+    WaitGroup(WaitGroup const&) = delete;
+    WaitGroup& operator=(WaitGroup const&) = delete;
+
+    void add(std::uint32_t const n = 1) noexcept { count_.fetch_add(n, std::memory_order_relaxed); }
+
+    // Marks one task as finished.
+    void done() noexcept {
+        if (count_.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            generation_.fetch_add(1, std::memory_order_seq_cst);
+            if (waiters_.load(std::memory_order_seq_cst) != 0) RUST_ATTR_UNLIKELY
+                sys::impl::futex_wake_all(generation_);
+        }
+    }
+
+    [[nodiscard]] std::uint32_t count() const noexcept { return count_.load(std::memory_order_relaxed); }
+
+    void wait() noexcept { wait_deadline(std::chrono::steady_clock::time_point::max()); }
+
+    template<class Rep, class Period>
+    bool wait_timeout(std::chrono::duration<Rep, Period> const dur) noexcept {
+        return wait_deadline(sys::deadline_after(dur));
+    }
+
+    // Returns false if `deadline` passed before the count reached zero.
+    bool wait_deadline(std::chrono::steady_clock::time_point const deadline) noexcept {
+        auto const generation = generation_.load(std::memory_order_acquire);
+        if (count_.load(std::memory_order_acquire) == 0)
+            return true;
+        auto const finished = [&] { return generation_.load(std::memory_order_seq_cst) != generation; };
+        sys::spin::Default spin{};
+        do {
+            if (finished())
+                return true;
+        } while (spin.spin());
+        waiters_.fetch_add(1, std::memory_order_seq_cst);
+        bool done = true;
+        while (!finished()) {
+            if (!sys::impl::futex_wait_until(generation_, generation, deadline)) {
+                done = finished();
+                break;
+            }
+        }
+        waiters_.fetch_sub(1, std::memory_order_relaxed);
+        return done;
+    }
+};
+
+} // namespace sync
+} // namespace rust
@@ -0,0 +1,309 @@
+// watch.hpp
+
+#pragma once
+
+#include "../_include.hpp"
+#include "../result.hpp"
+#include "../sys/spin.hpp"
+#include "../sys_common/node_pool.hpp"
+#include "../sys_common/time.hpp"
+#include "mpsc/waker.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <utility>
+
+namespace rust {
+namespace sync {
+namespace watch {
+
+// ------------------------------------------------------------------------------------------
+// errors
+
+// The sender is gone and the receiver has seen the last value.
+struct RecvError { constexpr RecvError() noexcept = default; };
+
+enum class RecvTimeoutError { Timeout, Disconnected };
+
+// ------------------------------------------------------------------------------------------
+// shared
+
+namespace detail {
+
+using Spin = sys::spin::Yield<64, 16>;
+
+// The latest value, published by a single sender and read in place by the receivers.
+// Publishing swaps in a new node and retires the old one, which is dropped once no receiver
+// holds it anymore, so it never waits for a reader. A node's seq is its value's version.
+template<class T>
+class Shared {
+    using pool_t = sys::NodePool<T>;
+    using node_t = typename pool_t::Node;
+
+    static constexpr std::uint64_t closed = 1; // the sender is gone
+    static constexpr std::uint64_t step = 2;
+
+    pool_t pool_;
+    alignas(64) std::atomic<node_t*> current_;
+    std::atomic<std::uint64_t> version_{step};
+    alignas(64) std::atomic<std::size_t> refs_{2};
+
+public:
+    using node_type = node_t;
+
+    mpsc::detail::Waker receivers;
+
+    explicit Shared(T&& init) {
+        auto* const node = pool_.take();
+        ::new (static_cast<void*>(node->storage)) T(std::move(init));
+        node->seq.store(step, std::memory_order_relaxed);
+        current_.store(node, std::memory_order_relaxed);
+    }
+
+    Shared(Shared const&) = delete;
+    Shared& operator=(Shared const&) = delete;
+
+    ~Shared() { pool_t::dispose(current_.load(std::memory_order_relaxed)); }
+
+    void acquire() noexcept { refs_.fetch_add(1, std::memory_order_relaxed); }
+
+    void release() noexcept {
+        if (refs_.fetch_sub(1, std::memory_order_acq_rel) == 1)
+            delete this;
+    }
+
+    [[nodiscard]] std::uint64_t version() const noexcept { return version_.load(std::memory_order_seq_cst); }
+    [[nodiscard]] static constexpr std::uint64_t strip(std::uint64_t const version) noexcept { return version & ~closed; }
+    [[nodiscard]] static constexpr bool is_closed(std::uint64_t const version) noexcept { return version & closed; }
+
+    // only called by the sender, which may read the current value without a reference
+    [[nodiscard]] T const& current() const noexcept { return *current_.load(std::memory_order_relaxed)->value(); }
+
+    // only called by the sender
+    void publish(T&& value) {
+        auto* const node = pool_.take();
+        ::new (static_cast<void*>(node->storage)) T(std::move(value));
+        auto const version = version_.load(std::memory_order_relaxed) + step;
+        node->seq.store(version, std::memory_order_release);
+        auto* const old = current_.exchange(node, std::memory_order_acq_rel);
+        version_.store(version, std::memory_order_seq_cst);
+        pool_.retire(old);
+        receivers.notify_all();
+    }
+
+    void close() noexcept {
+        version_.fetch_or(closed, std::memory_order_seq_cst);
+        receivers.notify_all();
+    }
+
+    // A reference to the current value. Only retries if a new value was published meanwhile.
+    node_t* borrow() noexcept {
+        for (;;) {
+            auto* const node = current_.load(std::memory_order_acquire);
+            if (node->acquire()) RUST_ATTR_LIKELY {
+                if (node->seq.load(std::memory_order_seq_cst) != 0) RUST_ATTR_LIKELY
+                    return node;
+                pool_.release(node);
+            }
+        }
+    }
+
+    void release(node_t* const node) noexcept { pool_.release(node); }
+};
+
+} // namespace detail
+
+// ------------------------------------------------------------------------------------------
+// channel
+
+template<class T> class Sender;
+template<class T> class Receiver;
+
+template<class T>
+[[nodiscard]] std::pair<Sender<T>, Receiver<T>> channel(T init);
+
+// A borrowed value. It stays the same while held, however many newer values are sent meanwhile,
+// and must not outlive the receiver it came from.
+template<class T>
+class Ref {
+    using shared_t = detail::Shared<T>;
+
+    shared_t* shared_;
+    typename shared_t::node_type* node_;
+    bool changed_;
+
+    Ref(shared_t* const shared, typename shared_t::node_type* const node, bool const changed) noexcept
+        : shared_{shared}, node_{node}, changed_{changed} {}
+    friend class Receiver<T>;
+
+public:
+    Ref(Ref&& other) noexcept
+        : shared_{other.shared_}
+        , node_{std::exchange(other.node_, nullptr)}
+        , changed_{other.changed_}
+    {}
+
+    Ref(Ref const&) = delete;
+    Ref& operator=(Ref const&) = delete;
+    Ref& operator=(Ref&&) = delete;
+
+    ~Ref() {
+        if (node_)
+            shared_->release(node_);
+    }
+
+    // whether the value had not been seen by the receiver when it was borrowed
+    [[nodiscard]] bool has_changed() const noexcept { return changed_; }
+
+    [[nodiscard]] T const& get() const noexcept { return *node_->value(); }
+    [[nodiscard]] T const& operator*() const noexcept { return get(); }
+    [[nodiscard]] T const* operator->() const noexcept { return &get(); }
+};
+
+// The single writing half of a watch channel, holding the latest value.
+template<class T>
+class Sender {
+    detail::Shared<T>* shared_;
+
+    constexpr explicit Sender(detail::Shared<T>* const shared) noexcept : shared_{shared} {}
+    friend std::pair<Sender<T>, Receiver<T>> channel<T>(T);
+
+public:
+    Sender(Sender&& other) noexcept : shared_{std::exchange(other.shared_, nullptr)} {}
+
+    Sender& operator=(Sender&& other) noexcept {
+        Sender tmp(std::move(other));
+        std::swap(shared_, tmp.shared_);
+        return *this;
+    }
+
+    Sender(Sender const&) = delete;
+    Sender& operator=(Sender const&) = delete;
+
+    // receivers keep the last value, their waits for a change fail
+    ~Sender() {
+        if (shared_) {
+            shared_->close();
+            shared_->release();
+        }
+    }
+
+    // Replaces the value and wakes the receivers waiting for a change. Never blocks.
+    void send(T value) { shared_->publish(std::move(value)); }
+
+    // The current value, valid until the next send.
+    [[nodiscard]] T const& borrow() const noexcept { return shared_->current(); }
+
+    // A new receiver, which has seen the current value.
+    [[nodiscard]] Receiver<T> subscribe() const noexcept;
+};
+
+// A reading half of a watch channel. Copies track which values they have seen independently.
+// A receiver is used by one thread at a time.
+template<class T>
+class Receiver {
+    using shared_t = detail::Shared<T>;
+
+    shared_t* shared_;
+    std::uint64_t seen_;
+
+    Receiver(shared_t* const shared, std::uint64_t const seen) noexcept : shared_{shared}, seen_{seen} {}
+    friend class Sender<T>;
+    friend std::pair<Sender<T>, Receiver<T>> channel<T>(T);
+
+public:
+    Receiver(Receiver const& other) noexcept : shared_{other.shared_}, seen_{other.seen_} { shared_->acquire(); }
+    Receiver(Receiver&& other) noexcept : shared_{std::exchange(other.shared_, nullptr)}, seen_{other.seen_} {}
+
+    Receiver& operator=(Receiver other) noexcept {
+        std::swap(shared_, other.shared_);
+        std::swap(seen_, other.seen_);
+        return *this;
+    }
+
+    ~Receiver() {
+        if (shared_)
+            shared_->release();
+    }
+
+    [[nodiscard]] Receiver clone() const noexcept { return *this; }
+
+    // The latest value, without marking it as seen.
+    [[nodiscard]] Ref<T> borrow() const noexcept {
+        auto* const node = shared_->borrow();
+        return Ref<T>{shared_, node, node->seq.load(std::memory_order_relaxed) != seen_};
+    }
+
+    // The latest value, marking it as seen.
+    [[nodiscard]] Ref<T> borrow_and_update() noexcept {
+        auto* const node = shared_->borrow();
+        auto const version = node->seq.load(std::memory_order_relaxed);
+        return Ref<T>{shared_, node, std::exchange(seen_, version) != version};
+    }
+
+    // Whether a value was sent since the last one seen. Fails once the sender is gone.
+    [[nodiscard]] result::Result<bool, RecvError> has_changed() const noexcept {
+        auto const version = shared_->version();
+        if (shared_t::is_closed(version))
+            return result::Err<bool, RecvError>();
+        return result::Ok<bool, RecvError>(shared_t::strip(version) != seen_);
+    }
+
+    // Marks the latest value as seen.
+    void mark_unchanged() noexcept { seen_ = shared_t::strip(shared_->version()); }
+
+    // Blocks until a value the receiver has not seen is sent, and marks it as seen.
+    // Fails once the sender is gone without one.
+    result::Result<unit_t, RecvError> changed() noexcept {
+        if (changed_deadline(std::chrono::steady_clock::time_point::max()).is_ok())
+            return result::Ok<unit_t, RecvError>();
+        return result::Err<unit_t, RecvError>();
+    }
+
+    template<class Rep, class Period>
+    result::Result<unit_t, RecvTimeoutError> changed_timeout(std::chrono::duration<Rep, Period> const dur) noexcept {
+        return changed_deadline(sys::deadline_after(dur));
+    }
+
+    result::Result<unit_t, RecvTimeoutError> changed_deadline(std::chrono::steady_clock::time_point const deadline) noexcept {
+        for (;;) {
+            detail::Spin spin{};
+            std::uint64_t version;
+            do {
+                version = shared_->version();
+                if (shared_t::strip(version) != seen_) {
+                    seen_ = shared_t::strip(version);
+                    return result::Ok<unit_t, RecvTimeoutError>();
+                }
+                if (shared_t::is_closed(version))
+                    return result::Err<unit_t, RecvTimeoutError>(RecvTimeoutError::Disconnected);
+            } while (spin.spin());
+            if (!shared_->receivers.wait_until([this, version] { return shared_->version() != version; }, deadline)) {
+                if (shared_->version() != version)
+                    continue;
+                return result::Err<unit_t, RecvTimeoutError>(RecvTimeoutError::Timeout);
+            }
+        }
+    }
+};
+
+template<class T>
+Receiver<T> Sender<T>::subscribe() const noexcept {
+    shared_->acquire();
+    return Receiver<T>{shared_, detail::Shared<T>::strip(shared_->version())};
+}
+
+// A watch channel starting out with `init`, which the first receiver has seen.
+template<class T>
+[[nodiscard]] std::pair<Sender<T>, Receiver<T>> channel(T init) {
+    auto* const shared = new detail::Shared<T>(std::move(init));
+    auto const version = detail::Shared<T>::strip(shared->version());
+    return {Sender<T>{shared}, Receiver<T>{shared, version}};
+}
+
+} // namespace watch
+} // namespace sync
+} // namespace rust
@@ -0,0 +1,133 @@
+// work_deque.hpp
+
+#pragma once
+
+#include "../_include.hpp"
+#include "../option.hpp"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <type_traits>
+#include <vector>
+
+namespace rust {
+namespace sync {
+
+enum class StealStatus {
+    Empty,   // nothing to steal
+    Retry,   // lost a race with another thread, worth trying again
+    Success,
+};
+
+template<class T>
+struct Steal {
+    StealStatus status;
+    T value; // only meaningful on success
+};
+
+// A Chase–Lev work-stealing deque, as in "Correct and Efficient Work-Stealing for Weak Memory
+// Models" (Lê et al., 2013). The owning thread pushes and pops at the bottom, any thread steals
+// from the top, so the owner works depth first and thieves take the oldest, largest tasks.
+//
+// Holds trivially copyable values, typically pointers to tasks. The buffer grows as needed and
+// outgrown buffers stay alive until the deque is dropped, since a thief may still read them.
+template<class T>
+class WorkDeque {
+    static_assert(std::is_trivially_copyable_v<T>, "WorkDeque holds trivially copyable values");
+
+    struct Buffer {
+        std::int64_t const cap; // a power of two
+        std::unique_ptr<std::atomic<T>[]> slots;
+
+        explicit Buffer(std::int64_t const c) : cap{c}, slots{new std::atomic<T>[static_cast<std::size_t>(c)]} {}
+
+        std::atomic<T>& at(std::int64_t const i) noexcept { return slots[static_cast<std::size_t>(i & (cap - 1))]; }
+    };
+
+    alignas(64) std::atomic<std::int64_t> top_{0};
+    alignas(64) std::atomic<std::int64_t> bottom_{0};
+    std::atomic<Buffer*> buffer_;
+    std::vector<std::unique_ptr<Buffer>> buffers_; // the current one last, owner only
+
+    Buffer* grow(Buffer* const old, std::int64_t const top, std::int64_t const bottom) {
+        auto next = std::make_unique<Buffer>(old->cap * 2);
+        for (auto i = top; i < bottom; ++i)
+            next->at(i).store(old->at(i).load(std::memory_order_relaxed), std::memory_order_relaxed);
+        auto* const raw = next.get();
+        buffers_.push_back(std::move(next));
+        buffer_.store(raw, std::memory_order_release);
+        return raw;
+    }
+
+public:
+    explicit WorkDeque(std::size_t const capacity = 64) {
+        std::int64_t cap = 1;
+        while (cap < static_cast<std::int64_t>(capacity))
+            cap <<= 1;
+        buffers_.push_back(std::make_unique<Buffer>(cap));
+        buffer_.store(buffers_.back().get(), std::memory_order_relaxed);
+    }
+
+    WorkDeque(WorkDeque const&) = delete;
+    WorkDeque& operator=(WorkDeque const&) = delete;
+
+    // Owner only.
+    void push(T const value) {
+        auto const bottom = bottom_.load(std::memory_order_relaxed);
+        auto const top = top_.load(std::memory_order_acquire);
+        auto* buffer = buffer_.load(std::memory_order_relaxed);
+        if (bottom - top >= buffer->cap) RUST_ATTR_UNLIKELY
+            buffer = grow(buffer, top, bottom);
+        buffer->at(bottom).store(value, std::memory_order_relaxed);
+        bottom_.store(bottom + 1, std::memory_order_release);
+    }
+
+    // Owner only. Takes the most recently pushed value.
+    option::Option<T> pop() noexcept {
+        auto const bottom = bottom_.load(std::memory_order_relaxed) - 1;
+        auto* const buffer = buffer_.load(std::memory_order_relaxed);
+        // claim the bottom slot before looking at the top, racing thieves for the last value
+        bottom_.store(bottom, std::memory_order_seq_cst);
+        auto const top = top_.load(std::memory_order_seq_cst);
+        if (top > bottom) {
+            bottom_.store(bottom + 1, std::memory_order_relaxed);
+            return option::None;
+        }
+        auto const value = buffer->at(bottom).load(std::memory_order_relaxed);
+        if (top == bottom) {
+            auto expected = top;
+            bool const won = top_.compare_exchange_strong(expected, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+            bottom_.store(bottom + 1, std::memory_order_relaxed);
+            if (!won)
+                return option::None;
+        }
+        return option::Some<T>(value);
+    }
+
+    // Any thread. Takes the least recently pushed value.
+    Steal<T> steal() noexcept {
+        auto top = top_.load(std::memory_order_seq_cst);
+        auto const bottom = bottom_.load(std::memory_order_seq_cst);
+        if (top >= bottom)
+            return {StealStatus::Empty, T{}};
+        auto* const buffer = buffer_.load(std::memory_order_acquire);
+        auto const value = buffer->at(top).load(std::memory_order_relaxed);
+        if (!top_.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+            return {StealStatus::Retry, T{}};
+        return {StealStatus::Success, value};
+    }
+
+    [[nodiscard]] bool is_empty() const noexcept {
+        return bottom_.load(std::memory_order_acquire) <= top_.load(std::memory_order_acquire);
+    }
+
+    [[nodiscard]] std::size_t len() const noexcept {
+        auto const n = bottom_.load(std::memory_order_acquire) - top_.load(std::memory_order_acquire);
+        return n > 0 ? static_cast<std::size_t>(n) : 0;
+    }
+};
+
+} // namespace sync
+} // namespace rust
@@ -0,0 +1,15 @@
+// futex.hpp
+
+#pragma once
+
+#include "platform.hpp"
+
+#ifdef RUST_WINDOWS
+
+#include "windows/futex.hpp"
+
+#elif defined(RUST_LINUX) || defined(RUST_MAC)
+
+#include "unix/futex.hpp"
+
+#endif
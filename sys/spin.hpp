@@ -0,0 +1,73 @@
+// spin.hpp
+
+#pragma once
+
+#include <cstdint>
+#include <thread>
+
+namespace rust {
+namespace sys {
+
+inline void spin_loop_hint() noexcept {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#elif defined(__aarch64__) || defined(__arm__)
+    asm volatile("yield" ::: "memory");
+#endif
+}
+
+// Waits out another thread that is midway through an operation and about to finish it.
+template<class F>
+void snooze_until(F&& done) noexcept {
+    for (std::uint32_t i = 0; !done(); ++i) {
+        if (i < 64)
+            spin_loop_hint();
+        else
+            std::this_thread::yield();
+    }
+}
+
+// Spin strategies decide how long a thread keeps retrying before it parks.
+// A fresh strategy is created for every wait and `spin()` returns false once it gives up.
+namespace spin {
+
+// park immediately
+struct Never {
+    constexpr bool spin() noexcept { return false; }
+};
+
+// busy-wait with a cpu pause hint up to `N` times
+template<std::uint32_t N>
+class Bounded {
+    std::uint32_t count_ = 0;
+public:
+    bool spin() noexcept {
+        if (count_ == N)
+            return false;
+        ++count_;
+        spin_loop_hint();
+        return true;
+    }
+};
+
+// busy-wait `N` times, then give up the time slice `M` times before parking
+template<std::uint32_t N, std::uint32_t M = N>
+class Yield {
+    std::uint32_t count_ = 0;
+public:
+    bool spin() noexcept {
+        if (count_ == N + M)
+            return false;
+        if (count_++ < N)
+            spin_loop_hint();
+        else
+            std::this_thread::yield();
+        return true;
+    }
+};
+
+using Default = Bounded<100>;
+
+} // namespace spin
+} // namespace sys
+} // namespace rust
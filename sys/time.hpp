@@ -0,0 +1,15 @@
+// time.hpp
+
+#pragma once
+
+#include "platform.hpp"
+
+#ifdef RUST_WINDOWS
+
+#include "windows/time.hpp"
+
+#elif defined(RUST_LINUX) || defined(RUST_MAC)
+
+#include "unix/time.hpp"
+
+#endif
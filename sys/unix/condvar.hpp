@@ -2,8 +2,18 @@
 
 #pragma once
 
+#include "../platform.hpp"
+
+#ifdef RUST_LINUX
+
+#include "futex_condvar.hpp"
+
+#else // RUST_LINUX
+
+#include <errno.h>
 #include <pthread.h>
 #include <chrono>
+#include <limits>
 
 #include "mutex.hpp"
 #include "../../debug/debug.hpp"
@@ -15,17 +25,10 @@ namespace impl {
 class Condvar {
     pthread_cond_t cv_ = PTHREAD_COND_INITIALIZER;
 public:
-    explicit Condvar() {
-        pthread_condattr_t attr;
-        auto err = pthread_condattr_init(&attr);
-        debug_assert_eq(err, 0);
-        err = pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
-        debug_assert_eq(err, 0);
-        err = pthread_cond_init(&cv_, &attr);
-        debug_assert_eq(err, 0);
-        err = pthread_condattr_destroy(&attr);
-        debug_assert_eq(err, 0);
-    }
+    constexpr Condvar() noexcept = default;
+
+    Condvar(Condvar const&) = delete;
+    Condvar& operator=(Condvar const&) = delete;
 
     ~Condvar() {
         auto const err = pthread_cond_destroy(&cv_);
@@ -47,12 +50,14 @@ public:
         debug_assert_eq(err, 0);
     }
 
-    template<class Mutex>
-    void wait_timeout(Mutex& m, std::chrono::time_point<std::chrono::system_clock, std::chrono::nanoseconds> const tp) {
+    // Returns false if `deadline` passed before a notification arrived.
+    // The condattr clock can't be changed here, so the deadline is translated onto the system clock.
+    bool wait_until(Mutex& m, std::chrono::steady_clock::time_point const deadline) {
         using namespace std::chrono;
-        nanoseconds d{tp.time_since_epoch()};
-        if (d > nanoseconds(0x59682F000000E941))
-            d = nanoseconds(0x59682F000000E941);
+        auto const rel = deadline - steady_clock::now();
+        if (rel <= rel.zero())
+            return false;
+        nanoseconds d{system_clock::now().time_since_epoch() + ceil<nanoseconds>(rel)};
         ::timespec ts;
         seconds const s{duration_cast<seconds>(d)};
         using ts_sec = decltype(ts.tv_sec);
@@ -68,8 +73,26 @@ public:
         debug_assert(err == ETIMEDOUT || err == 0);
         return (err == 0);
     }
+
+    // Like the above, but returns without sleeping if `abort()` holds. `interrupt` can't take the
+    // mutex to rule out a wake up landing before the wait starts, so the wait is cut into short
+    // slices instead, each ending as a spurious wake up.
+    template<class Abort>
+    bool wait_until(Mutex& m, std::chrono::steady_clock::time_point const deadline, Abort const& abort) {
+        if (abort())
+            return true;
+        auto const slice = std::chrono::steady_clock::now() + std::chrono::milliseconds{10};
+        if (slice >= deadline)
+            return wait_until(m, deadline);
+        (void)wait_until(m, slice);
+        return true;
+    }
+
+    void interrupt() { notify_all(); }
 };
 
 } // namespace impl 
 } // namespace sys
-} // namespace rust
\ No newline at end of file
+} // namespace rust
+
+#endif // RUST_LINUX
@@ -0,0 +1,127 @@
+// futex.hpp
+
+#pragma once
+
+#include "../platform.hpp"
+#include "../spin.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <limits>
+
+#ifdef RUST_LINUX
+    #include <errno.h>
+    #include <linux/futex.h>
+    #include <sys/syscall.h>
+    #include <time.h>
+    #include <unistd.h>
+#else // RUST_LINUX
+    #include <sched.h>
+#endif // RUST_LINUX
+
+namespace rust {
+namespace sys {
+namespace impl {
+
+#ifdef RUST_LINUX
+
+// Blocks while `futex == expected`. May return spuriously.
+inline void futex_wait(std::atomic<std::uint32_t> const& futex, std::uint32_t const expected) noexcept {
+    for (;;) {
+        if (futex.load(std::memory_order_relaxed) != expected)
+            return;
+        auto const r = ::syscall(SYS_futex, reinterpret_cast<std::uint32_t const*>(&futex),
+                                 FUTEX_WAIT_PRIVATE, expected, nullptr, nullptr, 0);
+        if (r < 0 && errno == EINTR)
+            continue;
+        return;
+    }
+}
+
+// Converts a steady_clock deadline into an absolute CLOCK_MONOTONIC timespec.
+// steady_clock is CLOCK_MONOTONIC on linux, so no clock needs to be read here.
+inline ::timespec to_timespec(std::chrono::steady_clock::time_point const deadline) noexcept {
+    using namespace std::chrono;
+    ::timespec ts;
+    auto const d = deadline.time_since_epoch();
+    if (d <= d.zero()) {
+        ts.tv_sec = 0;
+        ts.tv_nsec = 0;
+        return ts;
+    }
+    auto const s = duration_cast<seconds>(d);
+    using ts_sec = decltype(ts.tv_sec);
+    if (s.count() < std::numeric_limits<ts_sec>::max()) {
+        ts.tv_sec = static_cast<ts_sec>(s.count());
+        ts.tv_nsec = static_cast<decltype(ts.tv_nsec)>(duration_cast<nanoseconds>(d - s).count());
+    }
+    else {
+        ts.tv_sec = std::numeric_limits<ts_sec>::max();
+        ts.tv_nsec = 999'999'999;
+    }
+    return ts;
+}
+
+// Blocks while `futex == expected` until `deadline` has passed. May return spuriously.
+// Returns false only if the deadline was reached. time_point::max() waits without a timeout.
+inline bool futex_wait_until(std::atomic<std::uint32_t> const& futex, std::uint32_t const expected,
+                             std::chrono::steady_clock::time_point const deadline) noexcept {
+    if (deadline == std::chrono::steady_clock::time_point::max()) {
+        futex_wait(futex, expected);
+        return true;
+    }
+    auto const ts = to_timespec(deadline);
+    for (;;) {
+        if (futex.load(std::memory_order_relaxed) != expected)
+            return true;
+        // FUTEX_WAIT_BITSET takes an absolute timeout, so retries after EINTR keep the same deadline
+        auto const r = ::syscall(SYS_futex, reinterpret_cast<std::uint32_t const*>(&futex),
+                                 FUTEX_WAIT_BITSET_PRIVATE, expected, &ts, nullptr, FUTEX_BITSET_MATCH_ANY);
+        if (r < 0) {
+            if (errno == EINTR)
+                continue;
+            if (errno == ETIMEDOUT)
+                return false;
+        }
+        return true;
+    }
+}
+
+// Wakes up one thread blocked on `futex`. Returns whether a thread was woken.
+inline bool futex_wake(std::atomic<std::uint32_t> const& futex) noexcept {
+    return ::syscall(SYS_futex, reinterpret_cast<std::uint32_t const*>(&futex),
+                     FUTEX_WAKE_PRIVATE, 1) > 0;
+}
+
+// Wakes up all threads blocked on `futex`.
+inline void futex_wake_all(std::atomic<std::uint32_t> const& futex) noexcept {
+    ::syscall(SYS_futex, reinterpret_cast<std::uint32_t const*>(&futex),
+              FUTEX_WAKE_PRIVATE, INT32_MAX);
+}
+
+#else // RUST_LINUX
+
+// Without a futex the waiter yields its time slice and lets the caller re-check.
+// Spurious wakeups are allowed by the contract, so this stays correct.
+inline void futex_wait(std::atomic<std::uint32_t> const& futex, std::uint32_t const expected) noexcept {
+    if (futex.load(std::memory_order_relaxed) == expected)
+        ::sched_yield();
+}
+
+inline bool futex_wait_until(std::atomic<std::uint32_t> const& futex, std::uint32_t const expected,
+                             std::chrono::steady_clock::time_point const deadline) noexcept {
+    if (deadline != std::chrono::steady_clock::time_point::max() && std::chrono::steady_clock::now() >= deadline)
+        return false;
+    futex_wait(futex, expected);
+    return true;
+}
+
+inline bool futex_wake(std::atomic<std::uint32_t> const&) noexcept { return false; }
+inline void futex_wake_all(std::atomic<std::uint32_t> const&) noexcept {}
+
+#endif // RUST_LINUX
+
+} // namespace impl
+} // namespace sys
+} // namespace rust
@@ -0,0 +1,77 @@
+// futex_condvar.hpp
+
+#pragma once
+
+#include "futex.hpp"
+#include "futex_mutex.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+namespace rust {
+namespace sys {
+namespace impl {
+
+class Condvar {
+    // incremented on every notification
+    std::atomic<std::uint32_t> futex_{0};
+public:
+    constexpr Condvar() noexcept = default;
+
+    Condvar(Condvar const&) = delete;
+    Condvar& operator=(Condvar const&) = delete;
+
+    void notify_one() noexcept {
+        futex_.fetch_add(1, std::memory_order_relaxed);
+        futex_wake(futex_);
+    }
+
+    void notify_all() noexcept {
+        futex_.fetch_add(1, std::memory_order_relaxed);
+        futex_wake_all(futex_);
+    }
+
+    template<class M>
+    void wait(M& m) noexcept {
+        // a notification between the load and the futex_wait changes the value, so it can't be missed
+        auto const seq = futex_.load(std::memory_order_relaxed);
+        m.unlock();
+        futex_wait(futex_, seq);
+        m.lock();
+    }
+
+    // Returns false if `deadline` passed before a notification arrived.
+    template<class M>
+    bool wait_until(M& m, std::chrono::steady_clock::time_point const deadline) noexcept {
+        auto const seq = futex_.load(std::memory_order_relaxed);
+        m.unlock();
+        auto const woken = futex_wait_until(futex_, seq, deadline);
+        m.lock();
+        return woken;
+    }
+
+    // Like the above, but returns without sleeping if `abort()` holds once the notification count
+    // was read. Whoever makes it hold has to call `interrupt` afterwards, and `abort` has to read
+    // what it changed sequentially consistently.
+    template<class M, class Abort>
+    bool wait_until(M& m, std::chrono::steady_clock::time_point const deadline, Abort const& abort) noexcept {
+        auto const seq = futex_.load(std::memory_order_seq_cst);
+        if (abort())
+            return true;
+        m.unlock();
+        auto const woken = futex_wait_until(futex_, seq, deadline);
+        m.lock();
+        return woken;
+    }
+
+    // Wakes every waiter, as a spurious wake up, for them to check their abort condition.
+    void interrupt() noexcept {
+        futex_.fetch_add(1, std::memory_order_seq_cst);
+        futex_wake_all(futex_);
+    }
+};
+
+} // namespace impl
+} // namespace sys
+} // namespace rust
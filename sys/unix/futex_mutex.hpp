@@ -0,0 +1,172 @@
+// futex_mutex.hpp
+
+#pragma once
+
+#include "futex.hpp"
+#include "../spin.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <type_traits>
+
+namespace rust {
+namespace sys {
+namespace impl {
+
+// The abort check of a wait that can't be interrupted.
+struct Uninterruptible {
+    constexpr bool operator()() const noexcept { return false; }
+};
+
+// `Spin` is one of the sys::spin strategies.
+// With `Fair` set, unlocking a contended lock hands it directly to a waiting thread
+// instead of letting newly arriving threads barge in.
+template<class Spin, bool Fair>
+class FutexMutex {
+    static constexpr std::uint32_t locked = 1;    // the lock is held
+    static constexpr std::uint32_t contended = 2; // other threads may be waiting, only valid with `locked`
+    static constexpr std::uint32_t poisoned = 4;  // a thread panicked while holding the lock
+    static constexpr std::uint32_t handoff = 8;   // the lock is being passed to a waiter, only valid with `locked`
+    static constexpr std::uint32_t interrupt_step = 16; // the bits above count `interrupt` calls, reset on unlock
+
+    std::atomic<std::uint32_t> futex_{0};
+
+    std::uint32_t spin() const noexcept {
+        Spin spin{};
+        for (;;) {
+            // only spin while the lock is held without waiters
+            auto const state = futex_.load(std::memory_order_relaxed);
+            if ((state & (locked | contended)) != locked || !spin.spin())
+                return state;
+        }
+    }
+
+    // Returns false if `deadline` passed first. A timed out waiter leaves the contended bit behind,
+    // which only costs the next unlock a spurious wake.
+    // Also returns false once `abort()` holds, which is checked before every sleep.
+    template<class Abort = Uninterruptible>
+    bool lock_contended(std::chrono::steady_clock::time_point const deadline, Abort const& abort = {}) noexcept {
+        auto state = spin();
+        if (!(state & locked) && futex_.compare_exchange_strong(state, state | locked, std::memory_order_acquire, std::memory_order_relaxed))
+            return true;
+        bool waited = false;
+        for (;;) {
+            // only threads that already slept may take a handed-off lock
+            if constexpr (Fair) {
+                if (waited && (state & handoff)) {
+                    if (futex_.compare_exchange_strong(state, state & ~handoff, std::memory_order_acquire, std::memory_order_relaxed))
+                        return true;
+                    continue;
+                }
+            }
+            // mark the lock as contended so the unlocking thread knows to wake us
+            if ((state & (locked | contended)) != (locked | contended)) {
+                state = futex_.fetch_or(locked | contended, std::memory_order_acquire);
+                if (!(state & locked))
+                    return true;
+                state |= locked | contended;
+            }
+            if constexpr (!std::is_same_v<Abort, Uninterruptible>) {
+                // an `interrupt` after this load changes the word, so the sleep below can't miss it
+                auto const seen = futex_.load(std::memory_order_seq_cst);
+                if (abort())
+                    return false;
+                if (seen != state) {
+                    state = seen;
+                    continue;
+                }
+            }
+            if (!futex_wait_until(futex_, state, deadline))
+                return false;
+            waited = true;
+            state = spin();
+        }
+    }
+
+    void unlock_fair() noexcept {
+        auto state = futex_.load(std::memory_order_relaxed);
+        for (;;) {
+            if (!(state & contended)) {
+                if (futex_.compare_exchange_weak(state, state & poisoned, std::memory_order_release, std::memory_order_relaxed))
+                    return;
+                continue;
+            }
+            // keep the lock held and pass it on
+            if (futex_.compare_exchange_weak(state, state | handoff, std::memory_order_release, std::memory_order_relaxed))
+                break;
+        }
+        if (futex_wake(futex_))
+            return;
+        // nobody was asleep, e.g. the contended bit was left by a waiter that timed out: take the
+        // hand-off back unless a waiter that was about to sleep already took it.
+        state |= handoff;
+        while (state & handoff) {
+            if (futex_.compare_exchange_weak(state, state & poisoned, std::memory_order_release, std::memory_order_relaxed)) {
+                // a thread arriving since the wake may have gone to sleep on the hand-off word, which
+                // it can't take without having slept before. any thread sleeping after the exchange
+                // sees the changed word, so one wake covers it.
+                futex_wake(futex_);
+                return;
+            }
+        }
+    }
+
+public:
+    constexpr FutexMutex() noexcept = default;
+
+    FutexMutex(FutexMutex const&) = delete;
+    FutexMutex& operator=(FutexMutex const&) = delete;
+
+    void lock() noexcept {
+        std::uint32_t expected = 0;
+        if (!futex_.compare_exchange_strong(expected, locked, std::memory_order_acquire, std::memory_order_relaxed))
+            lock_contended(std::chrono::steady_clock::time_point::max());
+    }
+
+    bool try_lock_until(std::chrono::steady_clock::time_point const deadline) noexcept {
+        std::uint32_t expected = 0;
+        return futex_.compare_exchange_strong(expected, locked, std::memory_order_acquire, std::memory_order_relaxed)
+            || lock_contended(deadline);
+    }
+
+    // Like the above, but also gives up once `abort()` holds. Whoever makes it hold has to call
+    // `interrupt` afterwards, and `abort` has to read what it changed sequentially consistently.
+    template<class Abort>
+    bool try_lock_until(std::chrono::steady_clock::time_point const deadline, Abort const& abort) noexcept {
+        std::uint32_t expected = 0;
+        return futex_.compare_exchange_strong(expected, locked, std::memory_order_acquire, std::memory_order_relaxed)
+            || lock_contended(deadline, abort);
+    }
+
+    void unlock() noexcept {
+        if constexpr (Fair)
+            unlock_fair();
+        else if (futex_.fetch_and(poisoned, std::memory_order_release) & contended)
+            futex_wake(futex_);
+    }
+
+    // Wakes every thread waiting for the lock to check its abort condition. The word changes
+    // too, so a thread about to sleep doesn't miss it.
+    void interrupt() noexcept {
+        futex_.fetch_add(interrupt_step, std::memory_order_seq_cst);
+        futex_wake_all(futex_);
+    }
+
+    bool try_lock() noexcept {
+        auto state = futex_.load(std::memory_order_relaxed);
+        while (!(state & locked)) {
+            if (futex_.compare_exchange_weak(state, state | locked, std::memory_order_acquire, std::memory_order_relaxed))
+                return true;
+        }
+        return false;
+    }
+
+    // The poison bit shares the lock word, so checking it after locking touches no other cache line.
+    bool is_poisoned() const noexcept { return futex_.load(std::memory_order_relaxed) & poisoned; }
+    void poison() noexcept { futex_.fetch_or(poisoned, std::memory_order_relaxed); }
+};
+
+} // namespace impl
+} // namespace sys
+} // namespace rust
@@ -0,0 +1,207 @@
+// futex_rwlock.hpp
+
+#pragma once
+
+#include "futex.hpp"
+#include "../../debug/debug.hpp"
+#include "../../panic.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+namespace rust {
+namespace sys {
+namespace impl {
+
+class RWLock {
+    // bits 0..30: number of readers, or `write_locked` if write locked
+    // bit 30: readers are waiting on `state_`
+    // bit 31: writers are waiting on `writer_notify_`
+    static constexpr std::uint32_t read_locked = 1;
+    static constexpr std::uint32_t mask = (1u << 30) - 1;
+    static constexpr std::uint32_t write_locked = mask;
+    static constexpr std::uint32_t max_readers = mask - 1;
+    static constexpr std::uint32_t readers_waiting = 1u << 30;
+    static constexpr std::uint32_t writers_waiting = 1u << 31;
+
+    std::atomic<std::uint32_t> state_{0};
+    // incremented every time a writer is woken
+    std::atomic<std::uint32_t> writer_notify_{0};
+
+    static constexpr bool is_unlocked(std::uint32_t const s) noexcept { return (s & mask) == 0; }
+    static constexpr bool is_write_locked(std::uint32_t const s) noexcept { return (s & mask) == write_locked; }
+    static constexpr bool has_readers_waiting(std::uint32_t const s) noexcept { return (s & readers_waiting) != 0; }
+    static constexpr bool has_writers_waiting(std::uint32_t const s) noexcept { return (s & writers_waiting) != 0; }
+    static constexpr bool has_reached_max_readers(std::uint32_t const s) noexcept { return (s & mask) == max_readers; }
+
+    // new readers queue behind waiting writers so writers can't starve
+    static constexpr bool is_read_lockable(std::uint32_t const s) noexcept {
+        return (s & mask) < max_readers && !has_readers_waiting(s) && !has_writers_waiting(s);
+    }
+
+    template<class Fn>
+    std::uint32_t spin_until(Fn&& fn) const noexcept {
+        int spin = 100;
+        for (;;) {
+            auto const state = state_.load(std::memory_order_relaxed);
+            if (fn(state) || spin == 0)
+                return state;
+            spin_loop_hint();
+            --spin;
+        }
+    }
+
+    std::uint32_t spin_read() const noexcept {
+        return spin_until([](std::uint32_t const s) { 
+            return !is_write_locked(s) || has_readers_waiting(s) || has_writers_waiting(s); 
+        });
+    }
+
+    std::uint32_t spin_write() const noexcept {
+        return spin_until([](std::uint32_t const s) { return is_unlocked(s) || has_writers_waiting(s); });
+    }
+
+    // The contended paths return false if `deadline` passed first. A timed out waiter may leave
+    // its waiting bit set, which only costs the next unlock a spurious wake.
+    bool read_contended(std::chrono::steady_clock::time_point const deadline) {
+        auto state = spin_read();
+        for (;;) {
+            if (is_read_lockable(state)) {
+                if (state_.compare_exchange_weak(state, state + read_locked, std::memory_order_acquire, std::memory_order_relaxed))
+                    return true;
+                continue;
+            }
+            if (has_reached_max_readers(state))
+                panic("rwlock maximum reader count exceeded");
+            if (!has_readers_waiting(state) && 
+                !state_.compare_exchange_strong(state, state | readers_waiting, std::memory_order_relaxed, std::memory_order_relaxed))
+                continue;
+            if (!futex_wait_until(state_, state | readers_waiting, deadline))
+                return false;
+            state = spin_read();
+        }
+    }
+
+    bool write_contended(std::chrono::steady_clock::time_point const deadline) noexcept {
+        auto state = spin_write();
+        std::uint32_t other_writers_waiting = 0;
+        for (;;) {
+            if (is_unlocked(state)) {
+                // keep the waiting bit set if other writers might still be sleeping
+                if (state_.compare_exchange_weak(state, state | write_locked | other_writers_waiting, 
+                                                 std::memory_order_acquire, std::memory_order_relaxed))
+                    return true;
+                continue;
+            }
+            if (!has_writers_waiting(state) &&
+                !state_.compare_exchange_strong(state, state | writers_waiting, std::memory_order_relaxed, std::memory_order_relaxed))
+                continue;
+            other_writers_waiting = writers_waiting;
+            auto const seq = writer_notify_.load(std::memory_order_acquire);
+            state = state_.load(std::memory_order_relaxed);
+            if (is_unlocked(state) || !has_writers_waiting(state))
+                continue;
+            if (!futex_wait_until(writer_notify_, seq, deadline))
+                return false;
+            state = spin_write();
+        }
+    }
+
+    bool wake_writer() noexcept {
+        writer_notify_.fetch_add(1, std::memory_order_release);
+        return futex_wake(writer_notify_);
+    }
+
+    // called when the lock becomes unlocked while threads are waiting
+    void wake_writer_or_readers(std::uint32_t state) noexcept {
+        debug_assert(is_unlocked(state));
+        if (state == writers_waiting) {
+            if (state_.compare_exchange_strong(state, 0, std::memory_order_relaxed, std::memory_order_relaxed)) {
+                wake_writer();
+                return;
+            }
+        }
+        if (state == (readers_waiting | writers_waiting)) {
+            if (!state_.compare_exchange_strong(state, readers_waiting, std::memory_order_relaxed, std::memory_order_relaxed))
+                return;
+            if (wake_writer())
+                return;
+            // no writer was actually waiting, so let the readers in
+            state = readers_waiting;
+        }
+        if (state == readers_waiting) {
+            if (state_.compare_exchange_strong(state, 0, std::memory_order_relaxed, std::memory_order_relaxed))
+                futex_wake_all(state_);
+        }
+    }
+
+public:
+    constexpr RWLock() noexcept = default;
+
+    RWLock(RWLock const&) = delete;
+    RWLock& operator=(RWLock const&) = delete;
+
+    void read() {
+        auto state = state_.load(std::memory_order_relaxed);
+        if (!is_read_lockable(state) || 
+            !state_.compare_exchange_weak(state, state + read_locked, std::memory_order_acquire, std::memory_order_relaxed))
+            read_contended(std::chrono::steady_clock::time_point::max());
+    }
+
+    bool try_read_until(std::chrono::steady_clock::time_point const deadline) {
+        auto state = state_.load(std::memory_order_relaxed);
+        return (is_read_lockable(state) && 
+                state_.compare_exchange_strong(state, state + read_locked, std::memory_order_acquire, std::memory_order_relaxed))
+            || read_contended(deadline);
+    }
+
+    bool try_read() noexcept {
+        auto state = state_.load(std::memory_order_relaxed);
+        while (is_read_lockable(state)) {
+            if (state_.compare_exchange_weak(state, state + read_locked, std::memory_order_acquire, std::memory_order_relaxed))
+                return true;
+        }
+        return false;
+    }
+
+    void write() noexcept {
+        std::uint32_t expected = 0;
+        if (!state_.compare_exchange_weak(expected, write_locked, std::memory_order_acquire, std::memory_order_relaxed))
+            write_contended(std::chrono::steady_clock::time_point::max());
+    }
+
+    bool try_write_until(std::chrono::steady_clock::time_point const deadline) noexcept {
+        std::uint32_t expected = 0;
+        return state_.compare_exchange_strong(expected, write_locked, std::memory_order_acquire, std::memory_order_relaxed)
+            || write_contended(deadline);
+    }
+
+    bool try_write() noexcept {
+        auto state = state_.load(std::memory_order_relaxed);
+        while (is_unlocked(state)) {
+            if (state_.compare_exchange_weak(state, state + write_locked, std::memory_order_acquire, std::memory_order_relaxed))
+                return true;
+        }
+        return false;
+    }
+
+    void read_unlock() noexcept {
+        auto const state = state_.fetch_sub(read_locked, std::memory_order_release) - read_locked;
+        // readers only wait while a writer holds or waits for the lock
+        debug_assert(!has_readers_waiting(state) || has_writers_waiting(state));
+        if (is_unlocked(state) && has_writers_waiting(state))
+            wake_writer_or_readers(state);
+    }
+
+    void write_unlock() noexcept {
+        auto const state = state_.fetch_sub(write_locked, std::memory_order_release) - write_locked;
+        debug_assert(is_unlocked(state));
+        if (has_writers_waiting(state) || has_readers_waiting(state))
+            wake_writer_or_readers(state);
+    }
+};
+
+} // namespace impl
+} // namespace sys
+} // namespace rust
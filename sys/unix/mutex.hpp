@@ -3,32 +3,38 @@
 #pragma once
 
 #include "../../debug/debug.hpp"
+#include "../platform.hpp"
 
+#include <atomic>
+#include <chrono>
 #include <errno.h>
 #include <pthread.h>
+#include <unistd.h>
+
+#include "futex_mutex.hpp"
 
 namespace rust {
 namespace sys {
 namespace impl {
 
+#ifdef RUST_LINUX
+
+using Mutex = FutexMutex<spin::Default, false>;
+
+#else // RUST_LINUX
+
 struct Mutex {
-    pthread_mutex_t mutex_;
-    
-    explicit Mutex() {
-        pthread_mutexattr_t attr;
-        auto err = pthread_mutexattr_init(&attr);
-        debug_assert_eq(err, 0);
-#ifdef RUST_DEBUG
-        err = pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_ERRORCHECK);
+#if defined(RUST_DEBUG) && defined(PTHREAD_ERRORCHECK_MUTEX_INITIALIZER_NP)
+    pthread_mutex_t mutex_ = PTHREAD_ERRORCHECK_MUTEX_INITIALIZER_NP;
 #else // RUST_DEBUG
-        err = pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_NORMAL);
+    pthread_mutex_t mutex_ = PTHREAD_MUTEX_INITIALIZER;
 #endif // RUST_DEBUG
-        debug_assert_eq(err, 0);
-        err = pthread_mutex_init(&mutex_, &attr);
-        debug_assert_eq(err, 0);
-        err = pthread_mutexattr_destroy(&attr);
-        debug_assert_eq(err, 0);
-    }
+    std::atomic_bool poisoned_{false};
+
+    constexpr Mutex() noexcept = default;
+
+    Mutex(Mutex const&) = delete;
+    Mutex& operator=(Mutex const&) = delete;
 
     ~Mutex() {
         auto const err = pthread_mutex_destroy(&mutex_);
@@ -48,22 +54,51 @@ struct Mutex {
     bool try_lock() {
         return (pthread_mutex_trylock(&mutex_) == 0);
     }
+
+    // pthread_mutex_timedlock is missing or bound to the realtime clock on these targets, so poll instead
+    bool try_lock_until(std::chrono::steady_clock::time_point const deadline) {
+        spin::Yield<100> spin{};
+        while (!try_lock()) {
+            if (std::chrono::steady_clock::now() >= deadline)
+                return false;
+            if (!spin.spin())
+                ::usleep(50);
+        }
+        return true;
+    }
+
+    template<class Abort>
+    bool try_lock_until(std::chrono::steady_clock::time_point const deadline, Abort const& abort) {
+        spin::Yield<100> spin{};
+        while (!try_lock()) {
+            if (abort() || std::chrono::steady_clock::now() >= deadline)
+                return false;
+            if (!spin.spin())
+                ::usleep(50);
+        }
+        return true;
+    }
+
+    // waiters poll, there is nobody to wake
+    void interrupt() noexcept {}
+
+    bool is_poisoned() const noexcept { return poisoned_.load(std::memory_order_relaxed); }
+    void poison() noexcept { poisoned_.store(true, std::memory_order_relaxed); }
 };
 
+#endif // RUST_LINUX
+
 class RecursiveMutex {
-    pthread_mutex_t mutex_;
+#ifdef PTHREAD_RECURSIVE_MUTEX_INITIALIZER_NP
+    pthread_mutex_t mutex_ = PTHREAD_RECURSIVE_MUTEX_INITIALIZER_NP;
+#else
+    pthread_mutex_t mutex_ = PTHREAD_RECURSIVE_MUTEX_INITIALIZER;
+#endif
 public:
-    explicit RecursiveMutex() {
-        pthread_mutexattr_t attr;
-        auto err = pthread_mutexattr_init(&attr);
-        debug_assert_eq(err, 0);
-        err = pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE);
-        debug_assert_eq(err, 0);
-        err = pthread_mutex_init(&mutex_, &attr);
-        debug_assert_eq(err, 0);
-        err = pthread_mutexattr_destroy(&attr);
-        debug_assert_eq(err, 0);
-    }
+    constexpr RecursiveMutex() noexcept = default;
+
+    RecursiveMutex(RecursiveMutex const&) = delete;
+    RecursiveMutex& operator=(RecursiveMutex const&) = delete;
 
     ~RecursiveMutex() {
         auto const err = pthread_mutex_destroy(&mutex_);
@@ -87,4 +122,4 @@ public:
 
 } // namespace impl
 } // namespace sys
-} // namespace rust
\ No newline at end of file
+} // namespace rust
@@ -1,11 +1,23 @@
 // rwlock.hpp
 
 #pragma once
+
+#include "../platform.hpp"
+
+#ifdef RUST_LINUX
+
+#include "futex_rwlock.hpp"
+
+#else // RUST_LINUX
+
 #include "../../debug/debug.hpp"
 #include "../../panic.hpp"
+#include "../spin.hpp"
 #include <atomic>
+#include <chrono>
 #include <errno.h>
 #include <pthread.h>
+#include <unistd.h>
 
 namespace rust {
 namespace sys {
@@ -15,9 +27,24 @@ class RWLock {
     pthread_rwlock_t handle_ = PTHREAD_RWLOCK_INITIALIZER;
     std::atomic_uint num_readers_{0};
     bool write_locked_{false};
+
+    template<class Fn>
+    static bool poll_until(std::chrono::steady_clock::time_point const deadline, Fn&& try_lock) {
+        spin::Yield<100> spin{};
+        while (!try_lock()) {
+            if (std::chrono::steady_clock::now() >= deadline)
+                return false;
+            if (!spin.spin())
+                ::usleep(50);
+        }
+        return true;
+    }
 public:
     constexpr RWLock() noexcept = default;
 
+    RWLock(RWLock const&) = delete;
+    RWLock& operator=(RWLock const&) = delete;
+
     ~RWLock() {
         auto const err = pthread_rwlock_destroy(&handle_);
         debug_assert_eq(err, 0);
@@ -73,6 +100,15 @@ public:
         return false;
     }
 
+    // pthread_rwlock_timed*lock is missing or bound to the realtime clock on these targets, so poll instead
+    bool try_read_until(std::chrono::steady_clock::time_point const deadline) {
+        return poll_until(deadline, [this] { return try_read(); });
+    }
+
+    bool try_write_until(std::chrono::steady_clock::time_point const deadline) {
+        return poll_until(deadline, [this] { return try_write(); });
+    }
+
     void raw_unlock() {
         auto const err = pthread_rwlock_unlock(&handle_);
         debug_assert_eq(err, 0);
@@ -94,4 +130,6 @@ public:
 
 } // namespace impl
 } // namespace sys
-} // namespace rust
\ No newline at end of file
+} // namespace rust
+
+#endif // RUST_LINUX
@@ -2,7 +2,13 @@
 
 #pragma once
 
+#include "../platform.hpp"
+
+#include <cstddef>
+#include <cstring>
+#include <limits.h>
 #include <pthread.h>
+#include <unistd.h>
 
 namespace rust {
 namespace sys {
@@ -12,6 +18,61 @@ namespace impl {
     pthread_exit(nullptr);
 }
 
-} // namespace rust
+// A native thread, joined or detached exactly once.
+class Thread {
+    pthread_t id_{};
+
+    explicit Thread(pthread_t const id) noexcept : id_{id} {}
+
+    static std::size_t round_to_page(std::size_t const n) noexcept {
+        auto const page = static_cast<std::size_t>(::sysconf(_SC_PAGESIZE));
+        return (n + page - 1) / page * page;
+    }
+
+public:
+    Thread() noexcept = default;
+
+    // Starts `main(arg)`. Sizes of 0 keep the platform defaults, others are rounded up to whole
+    // pages and the stack to at least PTHREAD_STACK_MIN. Returns an errno value on failure.
+    static int spawn(Thread& out, std::size_t const stack_size, std::size_t const guard_size,
+                     void* (*const main)(void*), void* const arg) noexcept {
+        pthread_attr_t attr;
+        if (int const r = pthread_attr_init(&attr); r != 0)
+            return r;
+        int r = 0;
+        if (stack_size != 0) {
+            // a sysconf call returning long on newer glibc
+            auto const min = static_cast<std::size_t>(PTHREAD_STACK_MIN);
+            auto const size = round_to_page(stack_size < min ? min : stack_size);
+            r = pthread_attr_setstacksize(&attr, size);
+        }
+        if (r == 0 && guard_size != 0)
+            r = pthread_attr_setguardsize(&attr, round_to_page(guard_size));
+        pthread_t id;
+        if (r == 0)
+            r = pthread_create(&id, &attr, main, arg);
+        pthread_attr_destroy(&attr);
+        if (r == 0)
+            out = Thread{id};
+        return r;
+    }
+
+    void join() noexcept { pthread_join(id_, nullptr); }
+    void detach() noexcept { pthread_detach(id_); }
+
+    // Names the calling thread for debuggers, truncated to what the platform allows.
+    static void set_name(char const* const name) noexcept {
+#if defined(RUST_LINUX)
+        char buf[16]; // including the terminator
+        std::strncpy(buf, name, sizeof(buf) - 1);
+        buf[sizeof(buf) - 1] = '\0';
+        pthread_setname_np(pthread_self(), buf);
+#elif defined(RUST_MAC)
+        pthread_setname_np(name);
+#endif
+    }
+};
+
+} // namespace impl
 } // namespace sys
-} // namespace impl
\ No newline at end of file
+} // namespace rust
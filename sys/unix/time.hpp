@@ -0,0 +1,50 @@
+// time.hpp
+
+#pragma once
+
+#include "../platform.hpp"
+
+#include <chrono>
+#include <time.h>
+
+namespace rust {
+namespace sys {
+namespace impl {
+
+#if defined(RUST_LINUX) && defined(CLOCK_MONOTONIC_COARSE)
+
+// steady_clock is CLOCK_MONOTONIC on linux and the coarse clock runs on the same timeline,
+// it is only updated once per tick and can be read without touching the clock source.
+inline std::chrono::steady_clock::time_point coarse_now() noexcept {
+    ::timespec ts;
+    ::clock_gettime(CLOCK_MONOTONIC_COARSE, &ts);
+    return std::chrono::steady_clock::time_point{std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+        std::chrono::seconds{ts.tv_sec} + std::chrono::nanoseconds{ts.tv_nsec})};
+}
+
+// how far coarse_now() may lag behind steady_clock::now()
+inline std::chrono::nanoseconds coarse_resolution() noexcept {
+    static std::chrono::nanoseconds const res = [] {
+        ::timespec ts;
+        if (::clock_getres(CLOCK_MONOTONIC_COARSE, &ts) != 0)
+            return std::chrono::nanoseconds{std::chrono::seconds{1}};
+        return std::chrono::seconds{ts.tv_sec} + std::chrono::nanoseconds{ts.tv_nsec};
+    }();
+    return res;
+}
+
+#else // RUST_LINUX
+
+inline std::chrono::steady_clock::time_point coarse_now() noexcept {
+    return std::chrono::steady_clock::now();
+}
+
+inline std::chrono::nanoseconds coarse_resolution() noexcept {
+    return std::chrono::nanoseconds{0};
+}
+
+#endif // RUST_LINUX
+
+} // namespace impl
+} // namespace sys
+} // namespace rust
@@ -0,0 +1,3 @@
+// futex.hpp
+
+#pragma once
@@ -0,0 +1,3 @@
+// time.hpp
+
+#pragma once
@@ -0,0 +1,138 @@
+// barrier.hpp
+
+#pragma once
+
+#include "../sys/futex.hpp"
+#include "../sys/spin.hpp"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <thread>
+
+namespace rust {
+namespace sys {
+
+// A combining tree barrier. Arrivals are counted in small per-node counters instead of one
+// shared counter: the last thread to reach a node carries the arrival up to its parent, and
+// the thread completing the root ends the phase. Waiters spin on the phase word, which is
+// only written once per phase, then park on it. Without a core for every thread they park right away.
+template<class Spin = spin::Yield<1000, 50>>
+class Barrier {
+    static constexpr std::size_t fan_in = 4;
+
+    // count in the low bits, parity of the phase the count belongs to in the top bit
+    static constexpr std::uint32_t parity_bit = std::uint32_t{1} << 31;
+
+    struct alignas(64) Node {
+        std::atomic<std::uint32_t> state{0};
+        std::uint32_t capacity = 0;
+        std::size_t parent = 0;
+    };
+
+    // bit 0 is set once a waiter parks, the rest counts phases
+    static constexpr std::uint32_t parked = 1;
+    static constexpr std::uint32_t phase_step = 2;
+
+    alignas(64) std::atomic<std::uint32_t> phase_{0};
+    std::unique_ptr<Node[]> nodes_;
+    std::size_t leaves_ = 0;
+    std::size_t root_ = 0;
+    // spinning only pays off while every participant can be running at the same time
+    bool spin_ = false;
+
+    // Counts one arrival at `node` for the phase with `parity`.
+    // Returns false if the node is already full, otherwise sets `last` if this arrival filled it.
+    static bool arrive(Node& node, std::uint32_t const parity, bool& last) noexcept {
+        auto state = node.state.load(std::memory_order_relaxed);
+        for (;;) {
+            // a count left over from the previous phase reads as zero
+            auto const count = (state & parity_bit) == parity ? state & ~parity_bit : 0;
+            if (count == node.capacity)
+                return false;
+            if (node.state.compare_exchange_weak(state, parity | (count + 1), std::memory_order_acq_rel, std::memory_order_relaxed)) {
+                last = count + 1 == node.capacity;
+                return true;
+            }
+        }
+    }
+
+    static std::size_t leaf_hint() noexcept {
+        // thread ids are often aligned addresses, so mix the hash before reducing it
+        auto const h = static_cast<std::uint64_t>(std::hash<std::thread::id>{}(std::this_thread::get_id()));
+        return static_cast<std::size_t>((h * 0x9E3779B97F4A7C15ull) >> 32);
+    }
+
+public:
+    // `n` threads have to call wait() to end a phase
+    explicit Barrier(std::size_t const n) {
+        if (n <= 1)
+            return;
+        // leaves take `fan_in` threads each, the last one the remainder
+        leaves_ = (n + fan_in - 1) / fan_in;
+        std::size_t total = leaves_;
+        for (auto level = leaves_; level > 1; level = (level + fan_in - 1) / fan_in)
+            total += (level + fan_in - 1) / fan_in;
+        nodes_ = std::make_unique<Node[]>(total);
+
+        for (std::size_t i = 0; i < leaves_; ++i)
+            nodes_[i].capacity = static_cast<std::uint32_t>(i + 1 < leaves_ ? fan_in : n - fan_in * (leaves_ - 1));
+        std::size_t start = 0;
+        for (auto level = leaves_; level > 1;) {
+            auto const next = start + level;
+            for (std::size_t i = 0; i < level; ++i) {
+                nodes_[start + i].parent = next + i / fan_in;
+                ++nodes_[next + i / fan_in].capacity;
+            }
+            start = next;
+            level = (level + fan_in - 1) / fan_in;
+        }
+        root_ = start;
+        spin_ = n <= std::thread::hardware_concurrency();
+    }
+
+    Barrier(Barrier const&) = delete;
+    Barrier& operator=(Barrier const&) = delete;
+
+    // Blocks until all threads arrived. Returns true for exactly one thread per phase.
+    bool wait() noexcept {
+        if (!nodes_)
+            return true;
+        // the phase can't end before this thread arrives, so it can be read up front
+        auto const phase = phase_.load(std::memory_order_acquire) & ~parked;
+        auto const parity = (phase & phase_step) ? parity_bit : 0;
+
+        bool last = false;
+        auto index = leaf_hint() % leaves_;
+        // exactly `n` threads arrive per phase and the leaves hold `n`, so probing finds a free slot
+        while (!arrive(nodes_[index], parity, last))
+            index = index + 1 == leaves_ ? 0 : index + 1;
+        while (last && index != root_) {
+            index = nodes_[index].parent;
+            last = false;
+            arrive(nodes_[index], parity, last);
+        }
+        if (last) {
+            if (phase_.exchange(phase + phase_step, std::memory_order_acq_rel) & parked)
+                impl::futex_wake_all(phase_);
+            return true;
+        }
+
+        Spin spin{};
+        for (;;) {
+            auto state = phase_.load(std::memory_order_acquire);
+            if ((state & ~parked) != phase)
+                return false;
+            if (spin_ && spin.spin())
+                continue;
+            if (!(state & parked) && !phase_.compare_exchange_weak(state, state | parked, std::memory_order_relaxed, std::memory_order_relaxed))
+                continue;
+            impl::futex_wait(phase_, phase | parked);
+        }
+    }
+};
+
+} // namespace sys
+} // namespace rust
@@ -6,35 +6,45 @@
 
 #include "../sys/condvar.hpp"
 #include "mutex.hpp"
+#include "time.hpp"
 
 namespace rust {
 namespace sys {
 
 class Condvar {
-    impl::Condvar cv_;
+    impl::Condvar cv_{};
 public:
-    Condvar() = default;
+    constexpr Condvar() noexcept = default;
 
     void notify_one() { cv_.notify_one(); }
     void notify_all() { cv_.notify_all(); }
 
-    void wait(Mutex& m) { cv_.wait(mutex::raw(m)); }
+    // `M` is sys::Mutex or, where the platform condvar is futex based, any sys::RawMutex
+    template<class M>
+    void wait(M& m) { cv_.wait(mutex::raw(m)); }
 
-    template<class Rep, class Period>
-    bool wait_timeout(Mutex& m, std::chrono::duration<Rep, Period> const dur) {
+    template<class M, class Rep, class Period>
+    bool wait_timeout(M& m, std::chrono::duration<Rep, Period> const dur) {
         if (dur <= dur.zero())
             return false;
-        using sys_tpf = std::chrono::time_point<std::chrono::system_clock, std::chrono::duration<long double, std::nano>>;
-        using sys_tpi = std::chrono::time_point<std::chrono::system_clock, std::chrono::nanoseconds>;
-        constexpr sys_tpf max{sys_tpi::max()};
-        std::chrono::system_clock::time_point const s_now{std::chrono::system_clock::now()};
-        if (max - dur > s_now)
-            return cv_.wait_timeout(mutex::raw(m), s_now + std::chrono::ceil<std::chrono::nanoseconds>(dur)));
-        else
-            return cv_.wait_timeout(mutex::raw(m), sys_tpi::max()));
+        return cv_.wait_until(mutex::raw(m), deadline_after(dur));
     }
+
+    // Returns false if `deadline` passed before a notification arrived.
+    template<class M>
+    bool wait_until(M& m, std::chrono::steady_clock::time_point const deadline) {
+        return cv_.wait_until(mutex::raw(m), deadline);
+    }
+
+    // Returns right away once `abort()` holds, having waited or not. Whoever makes it hold has to
+    // call `interrupt` afterwards, which waiters see as a spurious wake up.
+    template<class M, class Abort>
+    bool wait_until(M& m, std::chrono::steady_clock::time_point const deadline, Abort const& abort) {
+        return cv_.wait_until(mutex::raw(m), deadline, abort);
+    }
+
+    void interrupt() { cv_.interrupt(); }
 };
 
 } // namespace sys
 } // namespace rust
-
@@ -3,12 +3,17 @@
 #pragma once
 
 #include "../sys/mutex.hpp"
+#include "../sys/spin.hpp"
+#include "time.hpp"
+
+#include <chrono>
 
 namespace rust {
 namespace sys {
 
 class Condvar;
 class Mutex;
+template<class Spin, bool Fair> class RawMutex;
 
 class MutexGuard {
     Mutex& mutex_;
@@ -17,19 +22,60 @@ public:
     ~MutexGuard();
 };
 
-namespace mutex { constexpr impl::Mutex& raw(Mutex& m) noexcept { return m.mutex_; } }
+namespace mutex { 
+constexpr impl::Mutex& raw(Mutex& m) noexcept; 
+template<class Spin, bool Fair>
+constexpr impl::FutexMutex<Spin, Fair>& raw(RawMutex<Spin, Fair>& m) noexcept;
+} // namespace mutex
 
+// the platform's default lock
 class Mutex {
     impl::Mutex mutex_{};
     friend constexpr impl::Mutex& mutex::raw(Mutex&) noexcept;
 public:
+    constexpr Mutex() noexcept = default;
+
     [[nodiscard]] auto lock() { raw_lock(); return MutexGuard{*this}; }
     void raw_lock() { mutex_.lock(); }
     void raw_unlock() { mutex_.unlock(); }
     [[nodiscard]] bool try_lock() { return mutex_.try_lock(); }
+    [[nodiscard]] bool try_lock_until(std::chrono::steady_clock::time_point const deadline) { return mutex_.try_lock_until(deadline); }
+    // gives up once `abort()` holds, whoever makes it hold calls `interrupt` afterwards
+    template<class Abort>
+    [[nodiscard]] bool try_lock_until(std::chrono::steady_clock::time_point const deadline, Abort const& abort) { return mutex_.try_lock_until(deadline, abort); }
+    void interrupt() noexcept { mutex_.interrupt(); }
+    [[nodiscard]] bool is_poisoned() const noexcept { return mutex_.is_poisoned(); }
+    void poison() noexcept { mutex_.poison(); }
 };
 
-MutexGuard::~MutexGuard() { mutex_.raw_unlock(); }
+// a futex word lock with a configurable spin strategy and fairness, on every platform
+template<class Spin = spin::Default, bool Fair = false>
+class RawMutex {
+    impl::FutexMutex<Spin, Fair> mutex_{};
+    friend constexpr impl::FutexMutex<Spin, Fair>& mutex::raw<Spin, Fair>(RawMutex&) noexcept;
+public:
+    constexpr RawMutex() noexcept = default;
+
+    void raw_lock() { mutex_.lock(); }
+    void raw_unlock() { mutex_.unlock(); }
+    [[nodiscard]] bool try_lock() { return mutex_.try_lock(); }
+    [[nodiscard]] bool try_lock_until(std::chrono::steady_clock::time_point const deadline) { return mutex_.try_lock_until(deadline); }
+    // gives up once `abort()` holds, whoever makes it hold calls `interrupt` afterwards
+    template<class Abort>
+    [[nodiscard]] bool try_lock_until(std::chrono::steady_clock::time_point const deadline, Abort const& abort) { return mutex_.try_lock_until(deadline, abort); }
+    void interrupt() noexcept { mutex_.interrupt(); }
+    [[nodiscard]] bool is_poisoned() const noexcept { return mutex_.is_poisoned(); }
+    void poison() noexcept { mutex_.poison(); }
+};
+
+namespace mutex { 
+constexpr impl::Mutex& raw(Mutex& m) noexcept { return m.mutex_; } 
+
+template<class Spin, bool Fair>
+constexpr impl::FutexMutex<Spin, Fair>& raw(RawMutex<Spin, Fair>& m) noexcept { return m.mutex_; }
+} // namespace mutex
+
+inline MutexGuard::~MutexGuard() { mutex_.raw_unlock(); }
 
 } // namespace sys
-} // namespace rust
\ No newline at end of file
+} // namespace rust
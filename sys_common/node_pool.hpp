@@ -0,0 +1,108 @@
+// node_pool.hpp
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <new>
+#include <utility>
+
+namespace rust {
+namespace sys {
+
+// Value nodes published by a single writer and read in place by any number of readers.
+// A reader holds a reference to a node while it reads it, so retiring a node never waits:
+// its value is dropped by whoever lets go of it last, and the node goes back to the pool.
+// Nodes are only deleted with the pool, so a reader may safely try to reference a node it
+// loaded a moment ago, and checks `seq` afterwards to see whether it still holds that value.
+// take and retire may only be called by the writer.
+template<class T>
+class NodePool {
+public:
+    struct alignas(64) Node {
+        static constexpr std::uint32_t retired = std::uint32_t{1} << 31; // the writer let go of the node
+
+        // tags the value held, 0 while there is none
+        std::atomic<std::uint64_t> seq{0};
+        std::atomic<std::uint32_t> refs{0};
+        Node* next = nullptr; // in a free list
+        alignas(T) unsigned char storage[sizeof(T)];
+
+        T* value() noexcept { return std::launder(reinterpret_cast<T*>(storage)); }
+
+        // Fails once the node is retired with no references left, it may be reused any moment then.
+        bool acquire() noexcept {
+            auto state = refs.load(std::memory_order_relaxed);
+            do {
+                if (state == retired)
+                    return false;
+            } while (!refs.compare_exchange_weak(state, state + 1, std::memory_order_seq_cst, std::memory_order_relaxed));
+            return true;
+        }
+    };
+
+private:
+    Node* spare_ = nullptr;                          // owned by the writer
+    alignas(64) std::atomic<Node*> free_{nullptr};   // recycled by readers
+
+    void push_free(Node* const node) noexcept {
+        node->next = free_.load(std::memory_order_relaxed);
+        while (!free_.compare_exchange_weak(node->next, node, std::memory_order_release, std::memory_order_relaxed)) {}
+    }
+
+    static void delete_list(Node* node) noexcept {
+        while (node)
+            delete std::exchange(node, node->next);
+    }
+
+public:
+    constexpr NodePool() noexcept = default;
+
+    NodePool(NodePool const&) = delete;
+    NodePool& operator=(NodePool const&) = delete;
+
+    // nodes still in use belong to the caller, see dispose
+    ~NodePool() {
+        delete_list(spare_);
+        delete_list(free_.load(std::memory_order_relaxed));
+    }
+
+    // An empty node with no references, its value is constructed by the caller before `seq` is set.
+    Node* take() {
+        if (!spare_)
+            spare_ = free_.exchange(nullptr, std::memory_order_acquire);
+        if (!spare_)
+            return new Node{};
+        auto* const node = std::exchange(spare_, spare_->next);
+        // readers still trying the node see its old value gone and let go again
+        node->refs.store(0, std::memory_order_release);
+        return node;
+    }
+
+    // Readers referencing the node from now on see `seq` reset.
+    void retire(Node* const node) noexcept {
+        node->seq.store(0, std::memory_order_seq_cst);
+        if (node->refs.fetch_or(Node::retired, std::memory_order_seq_cst) == 0) {
+            node->value()->~T();
+            node->next = spare_;
+            spare_ = node;
+        }
+    }
+
+    // Drops a reader's reference.
+    void release(Node* const node) noexcept {
+        if (node->refs.fetch_sub(1, std::memory_order_acq_rel) == (Node::retired | 1)) {
+            node->value()->~T();
+            push_free(node);
+        }
+    }
+
+    // Deletes a node still holding a value, once no reader is left.
+    static void dispose(Node* const node) noexcept {
+        node->value()->~T();
+        delete node;
+    }
+};
+
+} // namespace sys
+} // namespace rust
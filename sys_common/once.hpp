@@ -0,0 +1,81 @@
+// once.hpp
+
+#pragma once
+
+#include "../sys/futex.hpp"
+
+#include <atomic>
+#include <cstdint>
+#include <utility>
+
+namespace rust {
+namespace sys {
+
+// A futex word state machine running a function exactly once.
+// Threads that find the function running sleep on the word until it finishes.
+class Once {
+    static constexpr std::uint32_t incomplete = 0;
+    static constexpr std::uint32_t poisoned = 1; // the function panicked
+    static constexpr std::uint32_t running = 2;
+    static constexpr std::uint32_t queued = 3;   // running, with threads waiting for it
+    static constexpr std::uint32_t complete = 4;
+
+    std::atomic<std::uint32_t> state_{incomplete};
+
+    // Publishes the final state and wakes the waiters. Also runs when the function panics,
+    // since a panic unwinds the thread, and then leaves the Once poisoned.
+    struct CompletionGuard {
+        std::atomic<std::uint32_t>& state;
+        std::uint32_t set_on_drop;
+
+        ~CompletionGuard() {
+            if (state.exchange(set_on_drop, std::memory_order_release) == queued)
+                impl::futex_wake_all(state);
+        }
+    };
+
+public:
+    constexpr Once() noexcept = default;
+
+    Once(Once const&) = delete;
+    Once& operator=(Once const&) = delete;
+
+    [[nodiscard]] bool is_completed() const noexcept { return state_.load(std::memory_order_acquire) == complete; }
+    [[nodiscard]] bool is_poisoned() const noexcept { return state_.load(std::memory_order_relaxed) == poisoned; }
+
+    // Runs `f(was_poisoned)` unless a previous call completed, waiting for a concurrent call to finish.
+    // Returns false without running `f` if the Once is poisoned and `ignore_poison` is not set.
+    template<class F>
+    bool call(bool const ignore_poison, F&& f) {
+        auto state = state_.load(std::memory_order_acquire);
+        for (;;) {
+            switch (state) {
+            case poisoned:
+                if (!ignore_poison)
+                    return false;
+                [[fallthrough]];
+            case incomplete: {
+                if (!state_.compare_exchange_weak(state, running, std::memory_order_acquire, std::memory_order_acquire))
+                    continue;
+                CompletionGuard guard{state_, poisoned};
+                std::forward<F>(f)(state == poisoned);
+                guard.set_on_drop = complete;
+                return true;
+            }
+            case running:
+                if (!state_.compare_exchange_weak(state, queued, std::memory_order_acquire, std::memory_order_acquire))
+                    continue;
+                [[fallthrough]];
+            case queued:
+                impl::futex_wait(state_, queued);
+                state = state_.load(std::memory_order_acquire);
+                break;
+            default: // complete
+                return true;
+            }
+        }
+    }
+};
+
+} // namespace sys
+} // namespace rust
@@ -4,16 +4,22 @@
 
 #include "../sys/rwlock.hpp"
 
+#include <chrono>
+
 namespace rust {
 namespace sys {
 
 class RWLock {
     impl::RWLock rwlock_{};
 public:
+    constexpr RWLock() noexcept = default;
+
     void read() { rwlock_.read(); }
     [[nodiscard]] bool try_read() { return rwlock_.try_read(); }
     void write() { rwlock_.write(); }
     [[nodiscard]] bool try_write() { return rwlock_.try_write(); }
+    [[nodiscard]] bool try_read_until(std::chrono::steady_clock::time_point const deadline) { return rwlock_.try_read_until(deadline); }
+    [[nodiscard]] bool try_write_until(std::chrono::steady_clock::time_point const deadline) { return rwlock_.try_write_until(deadline); }
     void read_unlock() { rwlock_.read_unlock(); }
     void write_unlock() { rwlock_.write_unlock(); }
 };
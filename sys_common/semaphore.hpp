@@ -0,0 +1,90 @@
+// semaphore.hpp
+
+#pragma once
+
+#include "../_include.hpp"
+#include "../sys/futex.hpp"
+#include "../sys/spin.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+namespace rust {
+namespace sys {
+
+// A counting semaphore on a futex word holding the available permits.
+// Acquiring without contention is one CAS and releasing one fetch_add, plus a load of the
+// waiter count that only leads to a wake syscall while threads may be asleep.
+template<class Spin = spin::Default>
+class Semaphore {
+    alignas(64) std::atomic<std::uint32_t> permits_;
+    alignas(64) std::atomic<std::uint32_t> waiters_{0};       // threads that may be asleep
+    std::atomic<std::uint32_t> multi_waiters_{0};             // of those, the ones wanting more than one permit
+
+public:
+    constexpr explicit Semaphore(std::uint32_t const permits) noexcept : permits_{permits} {}
+
+    Semaphore(Semaphore const&) = delete;
+    Semaphore& operator=(Semaphore const&) = delete;
+
+    [[nodiscard]] std::uint32_t available() const noexcept { return permits_.load(std::memory_order_relaxed); }
+
+    bool try_acquire(std::uint32_t const n) noexcept {
+        auto permits = permits_.load(std::memory_order_relaxed);
+        while (permits >= n) {
+            if (permits_.compare_exchange_weak(permits, permits - n, std::memory_order_acquire, std::memory_order_relaxed))
+                return true;
+        }
+        return false;
+    }
+
+    // Returns false if `deadline` passed before `n` permits were available.
+    bool acquire_until(std::uint32_t const n, std::chrono::steady_clock::time_point const deadline) noexcept {
+        Spin spin{};
+        do {
+            if (try_acquire(n))
+                return true;
+        } while (spin.spin());
+
+        // counted before the waiter itself, so a release seeing the waiter sees this too
+        if (n > 1)
+            multi_waiters_.fetch_add(1, std::memory_order_relaxed);
+        waiters_.fetch_add(1, std::memory_order_seq_cst);
+        bool acquired = false;
+        auto permits = permits_.load(std::memory_order_seq_cst);
+        for (;;) {
+            if (permits >= n) {
+                if (permits_.compare_exchange_weak(permits, permits - n, std::memory_order_seq_cst)) {
+                    acquired = true;
+                    break;
+                }
+                continue;
+            }
+            if (!impl::futex_wait_until(permits_, permits, deadline)) {
+                acquired = try_acquire(n);
+                break;
+            }
+            permits = permits_.load(std::memory_order_seq_cst);
+        }
+        waiters_.fetch_sub(1, std::memory_order_relaxed);
+        if (n > 1)
+            multi_waiters_.fetch_sub(1, std::memory_order_relaxed);
+        return acquired;
+    }
+
+    // A single permit goes to a single waiter, unless someone waits for several and has to
+    // see whether it can go now.
+    void release(std::uint32_t const n) noexcept {
+        permits_.fetch_add(n, std::memory_order_seq_cst);
+        if (waiters_.load(std::memory_order_seq_cst) != 0) RUST_ATTR_UNLIKELY {
+            if (n == 1 && multi_waiters_.load(std::memory_order_relaxed) == 0)
+                impl::futex_wake(permits_);
+            else
+                impl::futex_wake_all(permits_);
+        }
+    }
+};
+
+} // namespace sys
+} // namespace rust
@@ -11,5 +11,7 @@ namespace sys {
     impl::thread_exit();
 }
 
+using Thread = impl::Thread;
+
 } // namespace sys
-} // namespace rust
\ No newline at end of file
+} // namespace rust
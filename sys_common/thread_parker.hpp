@@ -0,0 +1,62 @@
+// thread_parker.hpp
+
+#pragma once
+
+#include "../_include.hpp"
+#include "../sys/futex.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+namespace rust {
+namespace sys {
+
+// The token behind thread::park / Thread::unpark, a single futex word owned by one thread.
+// Unparking a thread that isn't parked is one swap.
+class Parker {
+    static constexpr std::uint32_t empty = 0;
+    static constexpr std::uint32_t notified = 1;
+    static constexpr std::uint32_t parked = std::uint32_t(-1); // empty - 1
+
+    std::atomic<std::uint32_t> state_{empty};
+
+public:
+    constexpr Parker() noexcept = default;
+
+    Parker(Parker const&) = delete;
+    Parker& operator=(Parker const&) = delete;
+
+    // Only called by the owning thread. Consumes the token, or blocks until it is made available.
+    // May return spuriously.
+    void park() noexcept {
+        // notified -> empty returns right away, empty -> parked goes to sleep
+        if (state_.fetch_sub(1, std::memory_order_acquire) == notified)
+            return;
+        for (;;) {
+            impl::futex_wait(state_, parked);
+            auto expected = notified;
+            if (state_.compare_exchange_strong(expected, empty, std::memory_order_acquire, std::memory_order_relaxed))
+                return;
+            // spurious wake up, keep sleeping
+        }
+    }
+
+    // Like `park`, but gives up at `deadline`.
+    void park_until(std::chrono::steady_clock::time_point const deadline) noexcept {
+        if (state_.fetch_sub(1, std::memory_order_acquire) == notified)
+            return;
+        impl::futex_wait_until(state_, parked, deadline);
+        // notified or not, the thread is no longer parked
+        state_.exchange(empty, std::memory_order_acquire);
+    }
+
+    // Makes the token available, waking the owner if it is parked.
+    void unpark() noexcept {
+        if (state_.exchange(notified, std::memory_order_release) == parked) RUST_ATTR_UNLIKELY
+            impl::futex_wake(state_);
+    }
+};
+
+} // namespace sys
+} // namespace rust
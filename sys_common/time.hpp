@@ -0,0 +1,35 @@
+// time.hpp
+
+#pragma once
+
+#include "../sys/time.hpp"
+
+#include <chrono>
+
+namespace rust {
+namespace sys {
+
+// Reads the monotonic clock. Timeouts this much longer than the coarse clock's resolution
+// are measured from the coarse clock, which is several times cheaper to read.
+template<class Rep, class Period>
+[[nodiscard]] std::chrono::steady_clock::time_point monotonic_now_for(std::chrono::duration<Rep, Period> const dur) {
+    auto const res = impl::coarse_resolution();
+    if (res.count() != 0 && dur >= 64 * res)
+        return impl::coarse_now() + res; // one tick of slack so the deadline never fires early
+    return std::chrono::steady_clock::now();
+}
+
+// The monotonic instant `dur` from now, saturating at time_point::max().
+template<class Rep, class Period>
+[[nodiscard]] std::chrono::steady_clock::time_point deadline_after(std::chrono::duration<Rep, Period> const dur) {
+    using namespace std::chrono;
+    if (dur <= dur.zero())
+        return steady_clock::now();
+    auto const now = monotonic_now_for(dur);
+    if (duration<long double, std::nano>{dur} >= duration<long double, std::nano>{steady_clock::time_point::max() - now})
+        return steady_clock::time_point::max();
+    return now + ceil<steady_clock::duration>(dur);
+}
+
+} // namespace sys
+} // namespace rust
@@ -0,0 +1,133 @@
+// wait_queue.hpp
+
+#pragma once
+
+#include "../sys/futex.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <utility>
+
+namespace rust {
+namespace sys {
+
+// Threads waiting on a key, kept in intrusive FIFO lists hashed by key.
+// Every Node lives on the stack of the thread waiting on it, so queueing never allocates.
+// All members except Node::wait_until must be called under one lock owned by the user.
+template<class Key, std::size_t Buckets = 64, class Hash = std::hash<Key>>
+class KeyedWaitQueue {
+    static_assert(Buckets > 0, "a KeyedWaitQueue needs at least one bucket");
+
+public:
+    class Node {
+        Key key_;
+        Node* prev_ = nullptr;
+        Node* next_ = nullptr;
+        bool queued_ = false;
+        std::atomic<std::uint32_t> notified_{0};
+
+        friend class KeyedWaitQueue;
+    public:
+        explicit Node(Key key) : key_(std::move(key)) {}
+
+        Node(Node const&) = delete;
+        Node& operator=(Node const&) = delete;
+
+        // Blocks the owning thread until the node is notified or `deadline` has passed.
+        // Called without the lock. Returns false on timeout.
+        bool wait_until(std::chrono::steady_clock::time_point const deadline) noexcept {
+            while (notified_.load(std::memory_order_acquire) == 0) {
+                if (!impl::futex_wait_until(notified_, 0, deadline))
+                    return notified_.load(std::memory_order_acquire) != 0;
+            }
+            return true;
+        }
+    };
+
+    constexpr KeyedWaitQueue() noexcept = default;
+
+    KeyedWaitQueue(KeyedWaitQueue const&) = delete;
+    KeyedWaitQueue& operator=(KeyedWaitQueue const&) = delete;
+
+    void push(Node& node) noexcept {
+        auto& b = bucket(node.key_);
+        node.prev_ = b.tail;
+        node.next_ = nullptr;
+        if (b.tail)
+            b.tail->next_ = &node;
+        else
+            b.head = &node;
+        b.tail = &node;
+        node.queued_ = true;
+    }
+
+    // Takes a node that timed out back out of the queue.
+    // Returns false if it was notified in the meantime and is no longer queued.
+    bool remove(Node& node) noexcept {
+        if (!node.queued_)
+            return false;
+        unlink(bucket(node.key_), node);
+        return true;
+    }
+
+    // Wakes up to `max` of the threads waiting on `key`, oldest first. Returns how many were woken.
+    std::size_t notify(Key const& key, std::size_t const max = std::numeric_limits<std::size_t>::max()) noexcept {
+        auto& b = bucket(key);
+        std::size_t n = 0;
+        for (auto* node = b.head; node && n < max;) {
+            auto* const next = node->next_;
+            if (node->key_ == key) {
+                unlink(b, *node);
+                wake(*node);
+                ++n;
+            }
+            node = next;
+        }
+        return n;
+    }
+
+    std::size_t notify_all() noexcept {
+        std::size_t n = 0;
+        for (auto& b : buckets_) {
+            while (b.head) {
+                auto& node = *b.head;
+                unlink(b, node);
+                wake(node);
+                ++n;
+            }
+        }
+        return n;
+    }
+
+private:
+    struct Bucket {
+        Node* head = nullptr;
+        Node* tail = nullptr;
+    };
+
+    Bucket buckets_[Buckets]{};
+
+    Bucket& bucket(Key const& key) noexcept(noexcept(Hash{}(key))) {
+        return buckets_[Hash{}(key) % Buckets];
+    }
+
+    static void unlink(Bucket& b, Node& node) noexcept {
+        (node.prev_ ? node.prev_->next_ : b.head) = node.next_;
+        (node.next_ ? node.next_->prev_ : b.tail) = node.prev_;
+        node.prev_ = node.next_ = nullptr;
+        node.queued_ = false;
+    }
+
+    // the waiter can't return before retaking the lock, so the node outlives the wake
+    static void wake(Node& node) noexcept {
+        node.notified_.store(1, std::memory_order_release);
+        impl::futex_wake(node.notified_);
+    }
+};
+
+} // namespace sys
+} // namespace rust
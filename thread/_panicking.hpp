@@ -0,0 +1,48 @@
+// _panicking.hpp
+
+#pragma once
+
+#include "../sys_common/thread.hpp"
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <utility>
+
+namespace rust {
+namespace thread {
+
+// What a panicking thread left behind: the message it panicked with.
+class PanicPayload {
+    std::string message_;
+
+public:
+    explicit PanicPayload(std::string message) noexcept : message_{std::move(message)} {}
+
+    [[nodiscard]] std::string_view message() const noexcept { return message_; }
+};
+    
+namespace impl {
+// constant-initialized and trivially destructible, so reading it needs no TLS init guard
+inline thread_local std::size_t panic_count = 0;
+
+inline std::size_t update_panic_count(std::size_t const amt) noexcept {
+    panic_count += amt;
+    return panic_count;
+}
+
+// How many `catch_unwind` frames are active on this thread. Without one, a panic ends the thread.
+inline thread_local std::size_t catch_depth = 0;
+
+// Thrown by a panic inside `catch_unwind`, unwinding the stack up to it.
+struct Unwind {
+    PanicPayload payload;
+};
+} // namespace impl
+
+[[nodiscard]] inline bool panicking() noexcept {
+    return impl::panic_count != 0;
+}
+
+} // namespace thread
+} // namespace rust
@@ -0,0 +1,75 @@
+// scoped.hpp
+
+#pragma once
+
+#include "../panic.hpp"
+#include "thread.hpp"
+
+#include <type_traits>
+#include <utility>
+
+namespace rust {
+namespace thread {
+
+// Spawned threads are joined at the end of the scope, so they may borrow anything that outlives
+// it. Handles returned by `spawn` must not outlive the scope either.
+class Scope {
+    impl::ScopeData data_;
+
+    Scope() noexcept = default;
+
+    template<class F>
+    friend auto scope(F&& f);
+    friend class Builder;
+
+public:
+    Scope(Scope const&) = delete;
+    Scope& operator=(Scope const&) = delete;
+
+    // Starts a thread running `f` within the scope. Panics if the platform refuses.
+    template<class F>
+    JoinHandle<impl::spawn_result_t<std::decay_t<F>>> spawn(F&& f) {
+        return Builder{}.spawn_scoped(*this, std::forward<F>(f)).expect("failed to spawn thread");
+    }
+};
+
+template<class F>
+result::Result<JoinHandle<impl::spawn_result_t<std::decay_t<F>>>, SpawnError> Builder::spawn_scoped(Scope& scope, F&& f) && {
+    return spawn_in(&scope.data_, std::forward<F>(f));
+}
+
+// Runs `f(scope)` and waits for every thread it spawned into the scope, even if `f` panics.
+// Panics if one of those threads panicked and nobody joined it to handle the panic:
+//
+//     std::vector<int> data = ...;
+//     thread::scope([&](thread::Scope& s) {
+//         s.spawn([&] { process(data.data(), half); });
+//         s.spawn([&] { process(data.data() + half, data.size() - half); });
+//     });
+template<class F>
+auto scope(F&& f) {
+    Scope s;
+    struct JoinAll {
+        impl::ScopeData const& data;
+        ~JoinAll() { data.wait_all(); }
+    };
+    if constexpr (std::is_void_v<std::invoke_result_t<F, Scope&>>) {
+        {
+            JoinAll const join{s.data_};
+            std::invoke(std::forward<F>(f), s);
+        }
+        if (s.data_.a_thread_panicked())
+            panic("a scoped thread panicked");
+    } else {
+        auto res = [&] {
+            JoinAll const join{s.data_};
+            return std::invoke(std::forward<F>(f), s);
+        }();
+        if (s.data_.a_thread_panicked())
+            panic("a scoped thread panicked");
+        return res;
+    }
+}
+
+} // namespace thread
+} // namespace rust
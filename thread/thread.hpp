@@ -2,23 +2,449 @@
 
 #pragma once
 
-#include "../panic.hpp"
+#include "../_include.hpp"
+#include "../option.hpp"
+#include "../result.hpp"
+#include "../sys/futex.hpp"
 #include "../sys_common/thread.hpp"
+#include "../sys_common/thread_parker.hpp"
+#include "../sys_common/time.hpp"
+#include "_panicking.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <functional>
+#include <iostream>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+
+#ifdef __GLIBCXX__
+    #include <cxxabi.h>
+#endif // __GLIBCXX__
 
 namespace rust {
 namespace thread {
-    
+
+// A unique identifier for a running thread, never reused within a process.
+class ThreadId {
+    std::uint64_t id_;
+
+public:
+    constexpr explicit ThreadId(std::uint64_t const id) noexcept : id_{id} {}
+
+    static ThreadId next() noexcept {
+        static std::atomic<std::uint64_t> counter{1};
+        return ThreadId{counter.fetch_add(1, std::memory_order_relaxed)};
+    }
+
+    [[nodiscard]] constexpr std::uint64_t as_u64() const noexcept { return id_; }
+
+    constexpr bool operator==(ThreadId const other) const noexcept { return id_ == other.id_; }
+    constexpr bool operator!=(ThreadId const other) const noexcept { return id_ != other.id_; }
+};
+
+namespace impl {
+
+// Shared by every Thread handle to the same thread.
+class ThreadInner {
+    std::atomic<std::size_t> refs_{1};
+
+public:
+    ThreadId const id = ThreadId::next();
+    bool const named;
+    std::string const name;
+    sys::Parker parker;
+
+    explicit ThreadInner(option::Option<std::string> name_) noexcept
+        : named{name_.is_some()}, name{named ? std::move(name_).unwrap() : std::string{}} {}
+
+    void acquire() noexcept { refs_.fetch_add(1, std::memory_order_relaxed); }
+
+    void release() noexcept {
+        if (refs_.fetch_sub(1, std::memory_order_acq_rel) == 1)
+            delete this;
+    }
+};
+
+// constant-initialized, so reading it needs no TLS init guard
+inline thread_local ThreadInner* current_thread = nullptr;
+
+// drops the thread's own reference to its handle when it exits
+struct CurrentThreadGuard {
+    bool armed = false;
+    ~CurrentThreadGuard() {
+        if (armed && current_thread)
+            current_thread->release();
+    }
+};
+
+inline thread_local CurrentThreadGuard current_thread_guard;
+
+// Installs the handle of the running thread, taking over one reference.
+inline ThreadInner* set_current(ThreadInner* const inner) noexcept {
+    current_thread = inner;
+    current_thread_guard.armed = true;
+    return inner;
+}
+
+// Threads not started by this library get their handle on first use.
+inline ThreadInner* current() {
+    if (auto* const inner = current_thread) RUST_ATTR_LIKELY
+        return inner;
+    return set_current(new ThreadInner(option::None));
+}
+
+} // namespace impl
+
+// A handle to a thread, cheap to copy.
+class Thread {
+    impl::ThreadInner* inner_;
+
+public:
+    explicit Thread(impl::ThreadInner* const inner) noexcept : inner_{inner} { inner_->acquire(); }
+
+    Thread(Thread const& other) noexcept : Thread(other.inner_) {}
+
+    Thread(Thread&& other) noexcept : inner_{std::exchange(other.inner_, nullptr)} {}
+
+    Thread& operator=(Thread other) noexcept {
+        std::swap(inner_, other.inner_);
+        return *this;
+    }
+
+    ~Thread() {
+        if (inner_)
+            inner_->release();
+    }
+
+    [[nodiscard]] ThreadId id() const noexcept { return inner_->id; }
+
+    [[nodiscard]] option::Option<std::string_view> name() const {
+        if (!inner_->named)
+            return option::None;
+        return option::Some<std::string_view>(inner_->name);
+    }
+
+    // Makes the thread's park token available, waking it if it is parked.
+    void unpark() const noexcept { inner_->parker.unpark(); }
+};
+
+// The handle of the calling thread.
+[[nodiscard]] inline Thread current() { return Thread{impl::current()}; }
+
+// Blocks until the calling thread's token is made available by `Thread::unpark`, then consumes it.
+// May return spuriously, so callers check their condition in a loop.
+inline void park() { impl::current()->parker.park(); }
+
+// Like `park`, but gives up after `dur`.
+template<class Rep, class Period>
+void park_timeout(std::chrono::duration<Rep, Period> const dur) {
+    impl::current()->parker.park_until(sys::deadline_after(dur));
+}
+
+// ------------------------------------------------------------------------------------------
+// spawning
+
+// The platform refused to start a thread, with its error code.
+class SpawnError {
+    int code_;
+
+public:
+    constexpr explicit SpawnError(int const code) noexcept : code_{code} {}
+
+    [[nodiscard]] constexpr int code() const noexcept { return code_; }
+
+    friend std::ostream& operator<<(std::ostream& os, SpawnError const& e) {
+        return os << "failed to spawn thread (error " << e.code_ << ')';
+    }
+};
+
 namespace impl {
-std::size_t update_panic_count(std::size_t const amt) noexcept {
-    thread_local std::size_t panic_count = 0;
-    panic_count += amt;
-    return panic_count;
+
+// What a thread running `F` returns, with unit_t standing in for void.
+template<class F>
+using spawn_result_t = std::conditional_t<std::is_void_v<std::invoke_result_t<F>>, unit_t, std::invoke_result_t<F>>;
+
+// Runs `f`, turning a panic inside it into an error instead of ending the thread. Any other
+// exception is caught the same way, with its `what()` as the message, so it can't unwind past
+// a caller relying on `f` returning, e.g. one with a job of its stack frame still queued.
+// Only a panic counts as panicking while it unwinds, so the guards another exception drops on
+// its way out don't poison their locks. pthread_exit and pthread_cancel unwind too, and are let
+// through to end the thread.
+template<class F>
+result::Result<spawn_result_t<F>, PanicPayload> catch_unwind(F&& f) {
+    using T = spawn_result_t<F>;
+    struct Depth {
+        Depth() noexcept { ++catch_depth; }
+        ~Depth() { --catch_depth; }
+    };
+    try {
+        Depth const depth{};
+        if constexpr (std::is_void_v<std::invoke_result_t<F>>) {
+            std::invoke(std::forward<F>(f));
+            return result::Ok<T, PanicPayload>();
+        } else {
+            return result::Ok<T, PanicPayload>(std::invoke(std::forward<F>(f)));
+        }
+    } catch (Unwind& unwind) {
+        // the panic is over once caught
+        --panic_count;
+        return result::Err<T, PanicPayload>(std::move(unwind.payload));
+#ifdef __GLIBCXX__
+    } catch (abi::__forced_unwind&) {
+        throw;
+#endif // __GLIBCXX__
+    } catch (std::exception const& e) {
+        return result::Err<T, PanicPayload>(PanicPayload{std::string{e.what()}});
+    } catch (...) {
+        return result::Err<T, PanicPayload>(PanicPayload{"unknown exception"});
+    }
+}
+
+// Continues a panic caught by `catch_unwind` on another thread, without reporting it again, so
+// outside a `catch_unwind` it ends this thread silently.
+[[noreturn]] inline void resume_unwind(PanicPayload payload) {
+    if (update_panic_count(1) > 1) {
+        std::cerr << "thread panicked while panicking. aborting.\n";
+        std::abort();
+    }
+    if (catch_depth != 0)
+        throw Unwind{std::move(payload)};
+    sys::thread_exit();
 }
+
+// The threads spawned in a thread::scope, which waits for all of them before returning.
+class ScopeData {
+    std::atomic<std::uint32_t> running_{0};
+    std::atomic<bool> a_thread_panicked_{false};
+
+public:
+    constexpr ScopeData() noexcept = default;
+
+    ScopeData(ScopeData const&) = delete;
+    ScopeData& operator=(ScopeData const&) = delete;
+
+    void increment() noexcept { running_.fetch_add(1, std::memory_order_relaxed); }
+
+    // Once the count reaches zero the scope may return and free this, so the wake that follows
+    // at worst hits some other waiter reusing the address spuriously.
+    void decrement(bool const panicked) noexcept {
+        if (panicked)
+            a_thread_panicked_.store(true, std::memory_order_relaxed);
+        if (running_.fetch_sub(1, std::memory_order_release) == 1)
+            sys::impl::futex_wake_all(running_);
+    }
+
+    void wait_all() const noexcept {
+        for (std::uint32_t n; (n = running_.load(std::memory_order_acquire)) != 0;)
+            sys::impl::futex_wait(running_, n);
+    }
+
+    // Whether a thread panicked without anyone joining it to see the panic. Only after `wait_all`.
+    [[nodiscard]] bool a_thread_panicked() const noexcept { return a_thread_panicked_.load(std::memory_order_relaxed); }
+};
+
+// The single allocation shared by a spawned thread and its JoinHandle, holding the closure until
+// the thread starts and the result after it finishes. Whichever side is done last frees it, and
+// only then counts the thread out of its scope, so no result outlives the data it borrows.
+template<class T>
+class Packet {
+    std::atomic<std::uint32_t> refs_{2};
+    std::atomic<bool> finished_{false};
+    bool unhandled_panic_ = false;
+    ScopeData* const scope_;
+    option::Option<result::Result<T, PanicPayload>> result_ = option::None;
+
+protected:
+    void finish(result::Result<T, PanicPayload>&& res) {
+        unhandled_panic_ = res.is_err();
+        result_ = option::Some<result::Result<T, PanicPayload>>(std::move(res));
+        finished_.store(true, std::memory_order_release);
+        release();
+    }
+
+public:
+    constexpr explicit Packet(ScopeData* const scope) noexcept : scope_{scope} {}
+    virtual ~Packet() = default;
+
+    Packet(Packet const&) = delete;
+    Packet& operator=(Packet const&) = delete;
+
+    [[nodiscard]] bool is_finished() const noexcept { return finished_.load(std::memory_order_acquire); }
+
+    // Only after the thread was joined.
+    result::Result<T, PanicPayload> take() {
+        unhandled_panic_ = false;
+        return std::move(result_).unwrap();
+    }
+
+    void release() noexcept {
+        if (refs_.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            auto* const scope = scope_;
+            bool const panicked = unhandled_panic_;
+            delete this;
+            if (scope)
+                scope->decrement(panicked);
+        }
+    }
+};
+
+template<class T, class F>
+class SpawnPacket final : public Packet<T> {
+    ThreadInner* const thread_; // the running thread's own reference
+    union { F f_; };
+
+public:
+    template<class G>
+    SpawnPacket(ScopeData* const scope, ThreadInner* const thread, G&& f)
+        : Packet<T>(scope), thread_{thread}, f_(std::forward<G>(f)) {}
+
+    // only when the thread never started
+    void discard() noexcept {
+        f_.~F();
+        thread_->release();
+    }
+
+    ~SpawnPacket() override {}
+
+    static void* main(void* const arg) {
+        auto* const self = static_cast<SpawnPacket*>(arg);
+        set_current(self->thread_);
+        if (self->thread_->named)
+            sys::Thread::set_name(self->thread_->name.c_str());
+        auto res = catch_unwind([self]() -> decltype(auto) {
+            // the closure's captures are dropped on this thread, right after it returns
+            F f(std::move(self->f_));
+            self->f_.~F();
+            return std::invoke(std::move(f));
+        });
+        self->finish(std::move(res));
+        return nullptr;
+    }
+};
+
 } // namespace impl
 
-[[nodiscard]] inline bool panicking() noexcept {
-    return impl::update_panic_count(0) != 0;
+// Owns a spawned thread. Dropping it detaches the thread.
+template<class T>
+class JoinHandle {
+    sys::Thread native_;
+    Thread thread_;
+    impl::Packet<T>* packet_;
+
+public:
+    JoinHandle(sys::Thread const native, Thread thread, impl::Packet<T>* const packet) noexcept
+        : native_{native}, thread_{std::move(thread)}, packet_{packet} {}
+
+    JoinHandle(JoinHandle&& other) noexcept
+        : native_{other.native_}, thread_{other.thread_}, packet_{std::exchange(other.packet_, nullptr)} {}
+
+    JoinHandle& operator=(JoinHandle&& other) noexcept {
+        JoinHandle tmp(std::move(other));
+        std::swap(native_, tmp.native_);
+        std::swap(thread_, tmp.thread_);
+        std::swap(packet_, tmp.packet_);
+        return *this;
+    }
+
+    JoinHandle(JoinHandle const&) = delete;
+    JoinHandle& operator=(JoinHandle const&) = delete;
+
+    ~JoinHandle() {
+        if (packet_) {
+            native_.detach();
+            packet_->release();
+        }
+    }
+
+    [[nodiscard]] Thread const& thread() const noexcept { return thread_; }
+
+    // Whether the thread's closure has returned or panicked. Never blocks.
+    [[nodiscard]] bool is_finished() const noexcept { return packet_->is_finished(); }
+
+    // Waits for the thread to finish. Fails with the panic payload if it panicked.
+    result::Result<T, PanicPayload> join() && {
+        native_.join();
+        auto res = packet_->take();
+        std::exchange(packet_, nullptr)->release();
+        return res;
+    }
+};
+
+class Scope;
+
+// Configures a thread before spawning it:
+//
+//     auto handle = thread::Builder{}.name("io-0").stack_size(64 * 1024).spawn(f).unwrap();
+class Builder {
+    option::Option<std::string> name_ = option::None;
+    std::size_t stack_size_ = 0;
+    std::size_t guard_size_ = 0;
+
+public:
+    Builder() noexcept = default;
+
+    // The thread's name, also shown by debuggers where the platform supports it.
+    Builder&& name(std::string name) && {
+        name_ = option::Some<std::string>(std::move(name));
+        return std::move(*this);
+    }
+
+    // In bytes, rounded up to whole pages. The platform default when not set.
+    Builder&& stack_size(std::size_t const size) && noexcept {
+        stack_size_ = size;
+        return std::move(*this);
+    }
+
+    // The inaccessible region below the stack that catches overflows, in bytes.
+    Builder&& guard_size(std::size_t const size) && noexcept {
+        guard_size_ = size;
+        return std::move(*this);
+    }
+
+    template<class F>
+    result::Result<JoinHandle<impl::spawn_result_t<std::decay_t<F>>>, SpawnError> spawn(F&& f) && {
+        return spawn_in(nullptr, std::forward<F>(f));
+    }
+
+    // Spawns into `scope`, see thread/scoped.hpp.
+    template<class F>
+    result::Result<JoinHandle<impl::spawn_result_t<std::decay_t<F>>>, SpawnError> spawn_scoped(Scope& scope, F&& f) &&;
+
+private:
+    template<class F>
+    result::Result<JoinHandle<impl::spawn_result_t<std::decay_t<F>>>, SpawnError> spawn_in(impl::ScopeData* const scope, F&& f) {
+        using T = impl::spawn_result_t<std::decay_t<F>>;
+        using Packet = impl::SpawnPacket<T, std::decay_t<F>>;
+        auto* const inner = new impl::ThreadInner(std::move(name_));
+        Thread thread{inner}; // the creator's reference goes to the running thread
+        auto* const packet = new Packet(scope, inner, std::forward<F>(f));
+        if (scope)
+            scope->increment();
+        sys::Thread native;
+        if (int const r = sys::Thread::spawn(native, stack_size_, guard_size_, &Packet::main, packet); r != 0) {
+            packet->discard();
+            delete static_cast<impl::Packet<T>*>(packet);
+            if (scope)
+                scope->decrement(false);
+            return result::Err<JoinHandle<T>, SpawnError>(SpawnError{r});
+        }
+        return result::Ok<JoinHandle<T>, SpawnError>(JoinHandle<T>{native, std::move(thread), packet});
+    }
+};
+
+// Starts a thread running `f` with the default configuration. Panics if the platform refuses.
+template<class F>
+[[nodiscard]] JoinHandle<impl::spawn_result_t<std::decay_t<F>>> spawn(F&& f) {
+    return Builder{}.spawn(std::forward<F>(f)).expect("failed to spawn thread");
 }
 
 } // namespace thread
-} // namespace rust
\ No newline at end of file
+} // namespace rust